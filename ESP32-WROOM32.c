@@ -18,9 +18,81 @@ const int daylightOffset_sec = 3600;  // Daylight saving time offset
 #define BAUD_RATE 9600
 #define SERIAL_SIZE_RX 1024
 
-// Timing for sending time updates to PIC
+// Link speed negotiation: both sides start at BAUD_RATE, then the ESP32
+// proposes the rates below (fastest first). The PIC acknowledges, both
+// switch, and the PIC must echo SYNC_PATTERN back unchanged before
+// BAUD:OK confirms the rate. The PIC reverts to BAUD_RATE by itself when
+// BAUD:OK does not arrive or its receiver sees framing errors.
+#define BAUD_NEGOTIATE true
+const unsigned long baudCandidates[] = {115200, 57600, 38400, 19200};
+#define BAUD_REPLY_MS 500         // Wait for BAUD:ACK / the echoed pattern
+#define BAUD_SWITCH_MS 50         // PIC switches once its ACK has drained
+#define BAUD_PIC_TRIAL_MS 2000    // PIC gives up on an unconfirmed rate
+#define LINK_SILENCE_MS 45000     // No samples at a negotiated rate -> renegotiate (3 PIC heartbeats)
+#define SYNC_PATTERN "UUU***0123456789:?@AZaz~"   // The echo (31 bytes) fits the PIC's 32-byte TX queue
+#define SYNC_TRIES 3              // The PIC skips the echo while its TX queue is full
+
+// A PIC built with LOW_POWER sleeps between tasks and wakes on the first
+// edge on RX, losing that byte: commands are preceded by a newline
+#define PIC_WAKE_MS 2
+
+// Configuration commands carry #<seq> and wait for ACK:<seq>. The PIC
+// holds back a command that needs an answer until the previous answer has
+// left its TX queue, so they are not sent back to back.
+#define PIC_ACK_MS 300
+#define PIC_CMD_TRIES 3
+
+// Binary telemetry: the PIC sends COBS-encoded frames between 0x00
+// delimiters (layout documented in PIC16F887.c). Set to false to keep the
+// PIC on the human-readable text report for debugging.
+#define USE_BINARY_TELEMETRY true
+#define FRAME_SAMPLE 0x01
+#define FRAME_SAMPLE_LEN 18
+#define FRAME_SAMPLE_RAW 0x02       // FRAME_SAMPLE + unfiltered T1/H1/L
+#define FRAME_SAMPLE_RAW_LEN 24
+
+// The PIC converts the LDR reading to lux (log-log response, see
+// PIC16F887.c) and sends it after L: LX:<lux> in text, a uint16 after the
+// five channel values in binary frames. "light" stays the legacy percent.
+
+// Deadband reporting: the PIC checks its channels every PIC_REPORT_MS and
+// sends only those that moved (UPD:... lines / FRAME_UPDATE frames with a
+// channel bitmap), or nothing. Full reports still come every 15 s and on
+// every sensor error transition; partial ones never change validity.
+#define FRAME_UPDATE 0x03
+#define PIC_REPORT_MS 5000              // Default; /control?rate= changes it
+
+// The PIC filters T1/H1/L: an EMA for T1/H1 (its RAM has no room for an
+// averaging window) and a median of 3 for L. Set to true to also receive
+// the unfiltered readings (raw_* in /sensorData).
+#define REQUEST_RAW_VALUES false
+#define FRAME_MAX_LEN 64
+
+// Store-and-forward: every sample is acknowledged with RXOK (text) or
+// RXOK:<seq> (binary). Without acknowledgements the PIC keeps its samples
+// in EEPROM and announces them with LOG:<n> once they resume; BACKFILL
+// makes it replay its log blocks one at a time as hex chunks
+// (BF:<seq>,<len>,<ofs>,<hex>), each block answered with BFACK:<seq>.
+// A block is a keyframe followed by per-channel nibble deltas (layout
+// documented in PIC16F887.c).
+#define LOG_BLOCK_MAX 64
+#define LOG_DATA_OFS 16                 // Header size; the samples follow
+#define LOG_STEP_S 60                   // One logged sample per minute
+#define HISTORY_SIZE 360                // One entry per minute: 6 hours
+#define HISTORY_INTERVAL_MS 60000
+
+// Timing for sending time updates to PIC. The PIC answers each resync
+// with TSYNC:OFS=<ms>,PPM=<ppm>,TUN=<n> and trims its own clock; the
+// interval doubles while the offset stays within TIME_SYNC_GOOD_MS and
+// halves when it does not.
 unsigned long lastTimeUpdate = 0;
-const unsigned long timeUpdateInterval = 10000; // Send time every 10 seconds
+const unsigned long timeUpdateInterval = 60000; // Shortest resync interval
+#define TIME_SYNC_MAX_MS 3600000UL              // Longest resync interval
+#define TIME_SYNC_GOOD_MS 250
+#define TIME_LINE_LEN 29                        // "TIME:hh:mm:ss.mmm,DD/MM/YYYY\n" on the wire
+unsigned long timeSyncInterval = timeUpdateInterval;
+long picOffsetMs = 0, picPpm = 0;
+int picOscTune = 0;
 bool initialTimeSent = false; // Flag to track if initial time was sent
 
 // Web server
@@ -31,6 +103,7 @@ struct SensorData {
   float lm35_temp = 0.0;
   float hih_humid = 0.0;
   float light = 0.0;
+  uint16_t lux = 0;       // Follows light; same validity
   float sht_temp = 0.0;
   float sht_humid = 0.0;
   bool lm35_valid = false;
@@ -38,6 +111,11 @@ struct SensorData {
   bool light_valid = false;
   bool sht_temp_valid = false;
   bool sht_humid_valid = false;
+  int sht_res_bits = 14;  // SHT21 temperature resolution of the last sample
+  float lm35_raw = 0.0;   // Unfiltered readings, when requested
+  float hih_raw = 0.0;
+  float light_raw = 0.0;
+  bool raw_valid = false;
   unsigned long last_update = 0;
 } sensorData;
 
@@ -45,11 +123,75 @@ struct SensorData {
 String serialBuffer = "";
 bool isDataComplete = false;
 
+// Last diagnostic line from the PIC (STAT:...), served on /status
+String lastStatusLine = "";
+
+// Receive state for binary frames (fixed buffers, no allocation)
+uint8_t frameBuffer[FRAME_MAX_LEN];
+size_t frameLength = 0;
+bool inBinaryFrame = false;
+uint8_t lastFrameSeq = 0;
+bool haveFrameSeq = false;
+unsigned long framesOk = 0, framesBad = 0, framesLost = 0;
+
+// Full / partial reports received, and report slots the PIC left out
+unsigned long reportsFull = 0, reportsPartial = 0, reportsSaved = 0;
+unsigned long lastReportMs = 0;
+unsigned long picReportMs = PIC_REPORT_MS;
+
+// Remote control: /control?mode=<0..4>, ?alarm=<s> (0 cancels) or
+// ?rate=<1..30 s> queues MODE/ALARM/RATE with a sequence number. The PIC
+// answers ACK:<seq> or NACK:<seq>,<err> (1 unknown command, 2 bad
+// argument, 3 busy); the last answer is shown on /status. The command is
+// sent from loop(), not from the web server task.
+char pendingCommand[24];
+volatile bool commandPending = false;
+uint16_t commandSeq = 0;
+String lastCommandReply = "";
+
+// Sample history served on /history. Live samples and replayed PIC log
+// records share the ring, so entries are not strictly in time order.
+struct HistoryEntry {
+  uint32_t t;               // Unix time
+  int16_t v[5];             // T1, H1, L, T2, H2 in tenths
+  uint8_t valid;            // Same bitmap as the binary frame
+};
+HistoryEntry history[HISTORY_SIZE];
+size_t historyHead = 0, historyCount = 0;
+unsigned long lastHistoryAdd = 0;
+bool haveHistory = false;
+unsigned long backfillOk = 0, backfillNoTime = 0, backfillBlocks = 0;
+int lastBackfillSeq = -1;
+uint8_t bfBlock[LOG_BLOCK_MAX];
+int bfBlockSeq = -1, bfBlockLen = 0, bfBlockHave = 0;
+
+// Current link rate and when it was negotiated
+unsigned long linkBaud = BAUD_RATE;
+unsigned long linkSince = 0;
+
 // Function declarations
 void setupWebServer();
 void parseSerialData(String dataString);
+void parseSensorTokens(const String &line);
 void parseSensorToken(String token);
-void sendTimeDataToPIC();
+bool sendTimeDataToPIC(uint16_t seq = 0);
+void wakePIC();
+void handleTimeSyncReply(const String &line);
+void acknowledgeSample(int seq);
+void countReport(bool partial);
+void setChannel(int idx, float value);
+void handleBackfillChunk(const String &line);
+void decodeLogBlock(const uint8_t *b, int len);
+void addHistory(uint32_t t, const int16_t *v, uint8_t valid);
+void addLiveHistory();
+void configurePIC();
+bool sendPICCommand(const char *cmd);
+bool waitForAck(uint16_t seq);
+void negotiateBaud();
+bool waitForLine(const char *prefix, String &line, unsigned long timeoutMs);
+size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out);
+uint16_t crc16Ccitt(const uint8_t *data, size_t len);
+void handleBinaryFrame(const uint8_t *encoded, size_t len);
 String getSensorDataJson();
 String getCurrentTimeJson();
 void parseJsonData(String jsonString);
@@ -926,7 +1068,7 @@ const char* htmlContent = R"rawliteral(
                     if (data.light_valid) {
                         const lightLevel = Math.min(100, Math.max(0, data.light));
                         document.getElementById('light-indicator').style.width = lightLevel + '%';
-                        document.getElementById('light-percentage').textContent = lightLevel.toFixed(0) + '%';
+                        document.getElementById('light-percentage').textContent = lightLevel.toFixed(0) + '% · ' + data.lux + ' lx';
                         
                         // Update light gauge
                         createGaugeChart('lightGauge', lightLevel, 100, '%', '#ffd93d');
@@ -986,7 +1128,7 @@ const char* htmlContent = R"rawliteral(
             
             document.getElementById('avg-temp').textContent = tempCount > 0 ? (tempSum / tempCount).toFixed(1) + '°C' : 'N/A';
             document.getElementById('avg-humid').textContent = humidCount > 0 ? (humidSum / humidCount).toFixed(0) + '%' : 'N/A';
-            document.getElementById('light-level').textContent = data.light_valid ? data.light.toFixed(0) + '%' : 'N/A';
+            document.getElementById('light-level').textContent = data.light_valid ? data.lux + ' lx' : 'N/A';
         }
         
         // Initial setup when page loads
@@ -1236,6 +1378,29 @@ void loop() {
   // Read serial data from PIC16F887
   while (Serial.available() > 0) {
     char c = Serial.read();
+    
+    // 0x00 opens a binary frame, the next 0x00 closes it
+    if (c == 0x00) {
+      if (inBinaryFrame && frameLength > 0) {
+        handleBinaryFrame(frameBuffer, frameLength);
+        inBinaryFrame = false;
+      } else {
+        inBinaryFrame = true;
+      }
+      frameLength = 0;
+      continue;
+    }
+    if (inBinaryFrame) {
+      if (frameLength < FRAME_MAX_LEN) {
+        frameBuffer[frameLength++] = (uint8_t)c;
+      } else {
+        framesBad++;            // Oversized, resynchronise on the next 0x00
+        inBinaryFrame = false;
+        frameLength = 0;
+      }
+      continue;
+    }
+    
     serialBuffer += c;
     
     // Check if we have a complete data line (PIC sends simple format now)
@@ -1250,14 +1415,257 @@ void loop() {
     parseSerialData(serialBuffer);
     serialBuffer = "";
     isDataComplete = false;
-    sensorData.last_update = millis();
+  }
+  
+  // Samples stopped arriving at the negotiated rate (e.g. the PIC fell
+  // back to BAUD_RATE after a reset) - start over from BAUD_RATE
+  if (linkBaud != BAUD_RATE &&
+      millis() - max(sensorData.last_update, linkSince) > LINK_SILENCE_MS) {
+    Serial.updateBaudRate(BAUD_RATE);
+    linkBaud = BAUD_RATE;
+    configurePIC();
+  }
+  
+  if (commandPending) {
+    wakePIC();
+    Serial.print(pendingCommand);
+    commandPending = false;
   }
   
   // Send initial time update to PIC only once after startup
   if (!initialTimeSent && millis() > 5000) { // Wait 5 seconds after startup
-    sendTimeDataToPIC();
+    configurePIC();
     initialTimeSent = true;
-    Serial.println("Initial time data sent to PIC. PIC will handle time incrementing locally.");
+    Serial.println("Initial time data sent to PIC. Resyncing periodically.");
+  }
+  
+  // Periodic resync; the PIC measures its drift from these
+  if (initialTimeSent && millis() - lastTimeUpdate >= timeSyncInterval) {
+    sendTimeDataToPIC();
+  }
+}
+
+// Push link rate, time, report format and rate to the PIC (at startup and
+// after a PIC reset), one acknowledged command at a time
+void configurePIC() {
+  char rate[12];
+  
+  if (BAUD_NEGOTIATE) negotiateBaud();
+  timeSyncInterval = timeUpdateInterval;  // The PIC lost its drift estimate
+  for (int i = 0; i < PIC_CMD_TRIES; i++) {
+    if (!sendTimeDataToPIC(++commandSeq) || waitForAck(commandSeq)) break;
+  }
+  sendPICCommand(USE_BINARY_TELEMETRY ? "FMT:B" : "FMT:T");
+  sendPICCommand(REQUEST_RAW_VALUES ? "RAW:1" : "RAW:0");
+  snprintf(rate, sizeof(rate), "RATE:%lu", picReportMs / 1000);
+  sendPICCommand(rate);
+}
+
+// Send cmd with a fresh #<seq> until the PIC acknowledges it; a NACK
+// (e.g. busy) or a lost reply is retried
+bool sendPICCommand(const char *cmd) {
+  for (int i = 0; i < PIC_CMD_TRIES; i++) {
+    wakePIC();
+    Serial.printf("%s#%u\n", cmd, ++commandSeq);
+    if (waitForAck(commandSeq)) return true;
+  }
+  return false;
+}
+
+// Wait for ACK:<seq>; false on NACK:<seq>,<err> or timeout. Replies to
+// older sequence numbers are skipped.
+bool waitForAck(uint16_t seq) {
+  String reply, ack = "ACK:" + String(seq);
+  unsigned long start = millis(), t;
+  
+  while ((t = millis() - start) < PIC_ACK_MS) {
+    if (!waitForLine("ACK:", reply, PIC_ACK_MS - t)) return false;
+    if (reply == ack) return true;
+    if (reply.startsWith(ack + ",")) return false;   // NACK:<seq>,<err> reads as ACK:<seq>,<err>
+  }
+  return false;
+}
+
+// Find the fastest rate that carries the test pattern intact. Blocking,
+// but only runs at startup and after the link is lost.
+void negotiateBaud() {
+  String reply;
+  
+  for (size_t i = 0; i < sizeof(baudCandidates) / sizeof(baudCandidates[0]); i++) {
+    unsigned long rate = baudCandidates[i];
+    
+    wakePIC();
+    Serial.printf("BAUD:%lu\n", rate);
+    if (!waitForLine("BAUD:", reply, BAUD_REPLY_MS) || reply != "BAUD:ACK") continue;
+    
+    Serial.flush();               // Our request leaves at the old rate
+    Serial.updateBaudRate(rate);
+    delay(BAUD_SWITCH_MS);
+    
+    // A missing echo is asked for again (well inside BAUD_PIC_TRIAL_MS);
+    // a garbled one means the rate does not work
+    bool echoed = false;
+    for (int tries = 0; tries < SYNC_TRIES; tries++) {
+      Serial.print("SYNC:" SYNC_PATTERN "\n");
+      if (!waitForLine("SYNC:", reply, BAUD_REPLY_MS)) continue;
+      echoed = (reply == "SYNC:" SYNC_PATTERN);
+      break;
+    }
+    if (echoed) {
+      Serial.print("BAUD:OK\n");
+      linkBaud = rate;
+      linkSince = millis();
+      return;
+    }
+    
+    // Pattern lost or garbled: let the PIC time out before the next try
+    Serial.updateBaudRate(BAUD_RATE);
+    delay(BAUD_PIC_TRIAL_MS);
+  }
+  linkBaud = BAUD_RATE;
+  linkSince = millis();
+}
+
+// Read text lines until one contains prefix (returned from the prefix on,
+// trimmed) or the timeout expires. Binary frames and other lines are
+// dropped while negotiating.
+bool waitForLine(const char *prefix, String &line, unsigned long timeoutMs) {
+  unsigned long start = millis();
+  bool inFrame = false;
+  
+  line = "";
+  while (millis() - start < timeoutMs) {
+    if (Serial.available() == 0) {
+      delay(1);
+      continue;
+    }
+    char c = Serial.read();
+    
+    if (c == 0x00) {
+      inFrame = !inFrame;
+      line = "";
+      continue;
+    }
+    if (inFrame) continue;
+    
+    if (c != '\n') {
+      if (line.length() < FRAME_MAX_LEN) line += c;
+      continue;
+    }
+    int at = line.indexOf(prefix);
+    if (at >= 0) {
+      line = line.substring(at);
+      line.trim();
+      return true;
+    }
+    line = "";
+  }
+  return false;
+}
+
+// Decode one COBS block (without delimiters). Returns the decoded length,
+// or 0 if the encoding is malformed.
+size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t i = 0, o = 0;
+  
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > len) return 0;
+    
+    for (uint8_t k = 1; k < code; k++) out[o++] = in[i++];
+    if (code < 0xFF && i < len) out[o++] = 0x00;
+  }
+  return o;
+}
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), same as the PIC
+uint16_t crc16Ccitt(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+int16_t readInt16(const uint8_t *p) {
+  return (int16_t)(p[0] | (p[1] << 8));
+}
+
+void handleBinaryFrame(const uint8_t *encoded, size_t len) {
+  uint8_t frame[FRAME_MAX_LEN];
+  size_t n = cobsDecode(encoded, len, frame);
+  
+  if (n < 4 || crc16Ccitt(frame, n - 2) != (uint16_t)(frame[n - 2] | (frame[n - 1] << 8))) {
+    framesBad++;
+    return;
+  }
+  framesOk++;
+  
+  // Sequence gaps mean frames lost on the link
+  uint8_t seq = frame[1];
+  if (haveFrameSeq) framesLost += (uint8_t)(seq - lastFrameSeq - 1);
+  lastFrameSeq = seq;
+  haveFrameSeq = true;
+  
+  if ((frame[0] == FRAME_SAMPLE && n == FRAME_SAMPLE_LEN) ||
+      (frame[0] == FRAME_SAMPLE_RAW && n == FRAME_SAMPLE_RAW_LEN)) {
+    uint8_t valid = frame[2];
+    
+    sensorData.lm35_valid = valid & 0x01;
+    sensorData.hih_valid = valid & 0x02;
+    sensorData.light_valid = valid & 0x04;
+    sensorData.sht_temp_valid = valid & 0x08;
+    sensorData.sht_humid_valid = valid & 0x10;
+    sensorData.sht_res_bits = frame[3];
+    
+    // Fixed-point tenths
+    if (sensorData.lm35_valid) sensorData.lm35_temp = readInt16(&frame[4]) / 10.0f;
+    if (sensorData.hih_valid) sensorData.hih_humid = readInt16(&frame[6]) / 10.0f;
+    if (sensorData.light_valid) sensorData.light = readInt16(&frame[8]) / 10.0f;
+    if (sensorData.sht_temp_valid) sensorData.sht_temp = readInt16(&frame[10]) / 10.0f;
+    if (sensorData.sht_humid_valid) sensorData.sht_humid = readInt16(&frame[12]) / 10.0f;
+    sensorData.lux = (uint16_t)readInt16(&frame[14]);
+    
+    sensorData.raw_valid = frame[0] == FRAME_SAMPLE_RAW;
+    if (sensorData.raw_valid) {
+      sensorData.lm35_raw = readInt16(&frame[16]) / 10.0f;
+      sensorData.hih_raw = readInt16(&frame[18]) / 10.0f;
+      sensorData.light_raw = readInt16(&frame[20]) / 10.0f;
+    }
+    
+    sensorData.last_update = millis();
+    countReport(false);
+    acknowledgeSample(seq);
+    addLiveHistory();
+  } else if (frame[0] == FRAME_UPDATE && n >= 5) {
+    // Bitmap of the channels that follow; the rest keep their values
+    uint8_t mask = frame[2];
+    size_t pos = 3;
+    
+    for (int i = 0; i < 5; i++) {
+      if (!(mask & (1 << i))) continue;
+      if (pos + 2 > n - 2) {
+        framesBad++;
+        return;
+      }
+      setChannel(i, readInt16(&frame[pos]) / 10.0f);
+      pos += 2;
+    }
+    if (mask & 0x04) {
+      if (pos + 2 > n - 2) {
+        framesBad++;
+        return;
+      }
+      sensorData.lux = (uint16_t)readInt16(&frame[pos]);
+    }
+    sensorData.last_update = millis();
+    countReport(true);
+    acknowledgeSample(seq);
+    addLiveHistory();
   }
 }
 
@@ -1265,20 +1673,106 @@ void parseSerialData(String dataString) {
   // Parse the simplified format from PIC: T1:25.3,H1:65,L:42,T2:24.8,H2:68
   dataString.trim();
   
-  // Reset validity flags
-  sensorData.lm35_valid = false;
-  sensorData.hih_valid = false;
-  sensorData.light_valid = false;
-  sensorData.sht_temp_valid = false;
-  sensorData.sht_humid_valid = false;
+  // Diagnostic lines carry scheduler/driver counters, not sensor values
+  if (dataString.startsWith("STAT:")) {
+    lastStatusLine = dataString;
+    return;
+  }
+  
+  if (dataString.startsWith("ACK:") || dataString.startsWith("NACK:")) {
+    lastCommandReply = dataString;
+    return;
+  }
   
-  // Parse each sensor value
+  if (dataString.startsWith("TSYNC:")) {
+    handleTimeSyncReply(dataString);
+    return;
+  }
+  
+  // The PIC restarted with default settings - configure it again
+  if (dataString.startsWith("PIC16F887")) {
+    configurePIC();
+    return;
+  }
+  
+  // Samples logged while we were away; fetch them
+  if (dataString.startsWith("LOG:")) {
+    if (dataString.substring(4).toInt() > 0) {
+      lastBackfillSeq = -1;
+      wakePIC();
+      Serial.print("BACKFILL\n");
+    }
+    return;
+  }
+  
+  if (dataString.startsWith("BF:")) {
+    handleBackfillChunk(dataString);
+    return;
+  }
+  
+  // Unfiltered values follow a full text report on a line of their own
+  if (dataString.startsWith("RAW:")) {
+    parseSensorTokens(dataString.substring(4));
+    return;
+  }
+  
+  // Partial report: only the listed channels changed, validity stays
+  bool partial = dataString.startsWith("UPD:");
+  
+  // Anything else that is not a sample line (alarm_end, echoes, ...)
+  if (!partial && !dataString.startsWith("T1:")) return;
+  
+  if (partial) {
+    dataString = dataString.substring(4);
+  } else {
+    // Reset validity flags
+    sensorData.lm35_valid = false;
+    sensorData.hih_valid = false;
+    sensorData.light_valid = false;
+    sensorData.sht_temp_valid = false;
+    sensorData.sht_humid_valid = false;
+    sensorData.raw_valid = false;
+  }
+  
+  parseSensorTokens(dataString);
+  
+  sensorData.last_update = millis();
+  countReport(partial);
+  acknowledgeSample(-1);
+  addLiveHistory();
+}
+
+// Channel order of the PIC report: T1, H1, L, T2, H2
+void setChannel(int idx, float value) {
+  switch (idx) {
+    case 0: sensorData.lm35_temp = value; sensorData.lm35_valid = true; break;
+    case 1: sensorData.hih_humid = value; sensorData.hih_valid = true; break;
+    case 2: sensorData.light = value; sensorData.light_valid = true; break;
+    case 3: sensorData.sht_temp = value; sensorData.sht_temp_valid = true; break;
+    case 4: sensorData.sht_humid = value; sensorData.sht_humid_valid = true; break;
+  }
+}
+
+// Every report slot without a report is one the deadband saved
+void countReport(bool partial) {
+  unsigned long now = millis();
+  
+  if (partial) reportsPartial++;
+  else reportsFull++;
+  if (lastReportMs != 0 && now - lastReportMs > picReportMs * 3 / 2) {
+    reportsSaved += (now - lastReportMs + picReportMs / 2) / picReportMs - 1;
+  }
+  lastReportMs = now;
+}
+
+// Parse each sensor value of a comma-separated NAME:value list
+void parseSensorTokens(const String &line) {
   int startIndex = 0;
-  while (startIndex < dataString.length()) {
-    int separatorIndex = dataString.indexOf(',', startIndex);
-    if (separatorIndex == -1) separatorIndex = dataString.length();
+  while (startIndex < line.length()) {
+    int separatorIndex = line.indexOf(',', startIndex);
+    if (separatorIndex == -1) separatorIndex = line.length();
     
-    String token = dataString.substring(startIndex, separatorIndex);
+    String token = line.substring(startIndex, separatorIndex);
     parseSensorToken(token);
     
     startIndex = separatorIndex + 1;
@@ -1301,26 +1795,227 @@ void parseSensorToken(String token) {
   } else if (sensorType == "L" && valueStr != "ERR") {
     sensorData.light = valueStr.toFloat();
     sensorData.light_valid = true;
+  } else if (sensorType == "LX") {
+    sensorData.lux = valueStr.toInt();
   } else if (sensorType == "T2" && valueStr != "ERR") {
     sensorData.sht_temp = valueStr.toFloat();
     sensorData.sht_temp_valid = true;
   } else if (sensorType == "H2" && valueStr != "ERR") {
     sensorData.sht_humid = valueStr.toFloat();
     sensorData.sht_humid_valid = true;
+  } else if (sensorType == "R2") {
+    sensorData.sht_res_bits = valueStr.toInt();
+  } else if (sensorType == "T1R") {
+    sensorData.lm35_raw = valueStr.toFloat();
+    sensorData.raw_valid = true;
+  } else if (sensorType == "H1R") {
+    sensorData.hih_raw = valueStr.toFloat();
+  } else if (sensorType == "LR") {
+    sensorData.light_raw = valueStr.toFloat();
   }
 }
 
-void sendTimeDataToPIC() {
+// TIME for the PIC; with seq != 0 it answers ACK:<seq>. False if there is
+// no local time to send.
+bool sendTimeDataToPIC(uint16_t seq) {
   struct tm timeinfo;
+  struct timeval tv;
+  char suffix[8] = "";
+  
+  lastTimeUpdate = millis();
+  wakePIC();
   if (!getLocalTime(&timeinfo)) {
     Serial.println("TIME:ERROR,DATE:ERROR");
+    return false;
+  }
+  if (seq) snprintf(suffix, sizeof(suffix), "#%u", seq);
+  
+  // Stamp the moment the line has fully arrived at the PIC
+  gettimeofday(&tv, NULL);
+  tv.tv_usec += (long)((TIME_LINE_LEN + strlen(suffix)) * 10 * 1000000ULL / linkBaud);
+  if (tv.tv_usec >= 1000000) {
+    tv.tv_sec++;
+    tv.tv_usec -= 1000000;
+  }
+  localtime_r(&tv.tv_sec, &timeinfo);
+  
+  // Send time and date in format: TIME:HH:MM:SS.mmm,DD/MM/YYYY[#seq] (the
+  // PIC takes lines of up to 46 characters)
+  Serial.printf("TIME:%02d:%02d:%02d.%03ld,%02d/%02d/%04d%s\n",
+                timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, (long)(tv.tv_usec / 1000),
+                timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900, suffix);
+  return true;
+}
+
+// The newline is taken as an empty line by an awake PIC
+void wakePIC() {
+  Serial.write('\n');
+  Serial.flush();
+  delay(PIC_WAKE_MS);
+}
+
+// Tell the PIC the sample arrived, so it does not log it to EEPROM
+void acknowledgeSample(int seq) {
+  wakePIC();
+  if (seq < 0) Serial.print("RXOK\n");
+  else Serial.printf("RXOK:%d\n", seq);
+}
+
+// BF:<seq>,<len>,<ofs>,<hex> - part of one PIC log block. Chunks arrive
+// in order; a gap discards the block and the PIC resends it after its
+// BFACK timeout. BF:END closes the replay.
+void handleBackfillChunk(const String &line) {
+  int c1 = line.indexOf(',');
+  int c2 = line.indexOf(',', c1 + 1);
+  int c3 = line.indexOf(',', c2 + 1);
+  
+  if (line == "BF:END" || c1 < 0 || c2 < 0 || c3 < 0) return;
+  int seq = line.substring(3, c1).toInt();
+  int len = line.substring(c1 + 1, c2).toInt();
+  int ofs = line.substring(c2 + 1, c3).toInt();
+  String hex = line.substring(c3 + 1);
+  
+  if (len > LOG_BLOCK_MAX || len < LOG_DATA_OFS) return;
+  if (ofs == 0) {
+    bfBlockSeq = seq;
+    bfBlockLen = len;
+    bfBlockHave = 0;
+  }
+  if (seq != bfBlockSeq || len != bfBlockLen || ofs != bfBlockHave) {
+    bfBlockSeq = -1;
     return;
   }
+  for (unsigned int i = 0; i + 1 < hex.length() && bfBlockHave < bfBlockLen; i += 2) {
+    bfBlock[bfBlockHave++] = (uint8_t)strtoul(hex.substring(i, i + 2).c_str(), NULL, 16);
+  }
+  if (bfBlockHave < bfBlockLen) return;
+  
+  // A retried block whose BFACK got lost is only stored once
+  if (seq != lastBackfillSeq) {
+    decodeLogBlock(bfBlock, bfBlockLen);
+    lastBackfillSeq = seq;
+  }
+  bfBlockSeq = -1;
   
-  // Send time and date in format: TIME:HH:MM:SS,DATE:DD/MM/YYYY
-  Serial.printf("TIME:%02d:%02d:%02d,DATE:%02d/%02d/%04d\n",
-                timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
-                timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
+  wakePIC();
+  Serial.printf("BFACK:%d\n", seq);
+}
+
+// Next 4-bit code of a block's sample stream, high nibble first. Past
+// the block it reads as 15, the end marker.
+static uint8_t logNibble(const uint8_t *b, int len, int &nib) {
+  int i = LOG_DATA_OFS + nib / 2;
+  uint8_t v = i < len ? b[i] : 0xFF;
+  
+  return (nib++ & 1) ? (v & 0x0F) : (v >> 4);
+}
+
+// Header: flags, seq, epoch (local-time seconds since 2000, LE), keyframe
+// T1/H1/L/T2/H2 (int16 LE, tenths); then, LOG_STEP_S apart, per sample
+// and channel
+// one nibble: delta from the keyframe + 7 (0..13), or 14 followed by the
+// 16-bit value. Nibble 15 (erased EEPROM) ends the stream; the block
+// carries no sample count.
+void decodeLogBlock(const uint8_t *b, int len) {
+  uint8_t flags = b[0];
+  uint32_t epoch = b[2] | (b[3] << 8) | (b[4] << 16) | ((uint32_t)b[5] << 24);
+  int16_t v[5];
+  int nib = 0;
+  int every = HISTORY_INTERVAL_MS / 1000 / LOG_STEP_S;
+  time_t start;
+  
+  backfillBlocks++;
+  struct tm tmv = {};
+  tmv.tm_year = 100;
+  tmv.tm_mday = 1 + epoch / 86400;
+  tmv.tm_hour = (epoch % 86400) / 3600;
+  tmv.tm_min = (epoch % 3600) / 60;
+  tmv.tm_sec = epoch % 60;
+  tmv.tm_isdst = -1;
+  start = mktime(&tmv);
+  
+  // Deltas are relative to the block's keyframe; an escape is absolute.
+  // A sample cut short by the end marker was never completed.
+  for (int i = 0; i < 5; i++) v[i] = readInt16(&b[6 + 2 * i]);
+  for (int k = 0; ; k++) {
+    if (k > 0) {
+      int i;
+      for (i = 0; i < 5; i++) {
+        uint8_t n = logNibble(b, len, nib);
+        if (n == 15) break;
+        if (n == 14) {
+          uint16_t raw = 0;
+          for (int j = 0; j < 4; j++) raw = (raw << 4) | logNibble(b, len, nib);
+          v[i] = (int16_t)raw;
+        } else {
+          v[i] = readInt16(&b[6 + 2 * i]) + (int)n - 7;
+        }
+      }
+      if (i < 5) break;
+    }
+    if (flags & 0x40) {
+      backfillNoTime++;         // The PIC clock was never set
+      continue;
+    }
+    // Backfilled samples are thinned to the live history rate
+    if (every <= 1 || k % every == 0) {
+      addHistory((uint32_t)(start + (time_t)k * LOG_STEP_S), v, flags & 0x1F);
+    }
+    backfillOk++;
+  }
+}
+
+void addHistory(uint32_t t, const int16_t *v, uint8_t valid) {
+  HistoryEntry &e = history[historyHead];
+  
+  e.t = t;
+  memcpy(e.v, v, sizeof(e.v));
+  e.valid = valid;
+  historyHead = (historyHead + 1) % HISTORY_SIZE;
+  if (historyCount < HISTORY_SIZE) historyCount++;
+}
+
+// At most one live sample per HISTORY_INTERVAL_MS, once NTP time is known
+void addLiveHistory() {
+  time_t now = time(NULL);
+  int16_t v[5];
+  uint8_t valid = 0;
+  
+  if (haveHistory && millis() - lastHistoryAdd < HISTORY_INTERVAL_MS) return;
+  if (now < 1000000000) return;
+  
+  v[0] = (int16_t)lroundf(sensorData.lm35_temp * 10);
+  v[1] = (int16_t)lroundf(sensorData.hih_humid * 10);
+  v[2] = (int16_t)lroundf(sensorData.light * 10);
+  v[3] = (int16_t)lroundf(sensorData.sht_temp * 10);
+  v[4] = (int16_t)lroundf(sensorData.sht_humid * 10);
+  if (sensorData.lm35_valid) valid |= 0x01;
+  if (sensorData.hih_valid) valid |= 0x02;
+  if (sensorData.light_valid) valid |= 0x04;
+  if (sensorData.sht_temp_valid) valid |= 0x08;
+  if (sensorData.sht_humid_valid) valid |= 0x10;
+  addHistory((uint32_t)now, v, valid);
+  lastHistoryAdd = millis();
+  haveHistory = true;
+}
+
+// TSYNC:OFS=<ms>,PPM=<ppm>,TUN=<n> - how far the PIC clock had drifted
+// before this resync; back off while it stays accurate
+void handleTimeSyncReply(const String &line) {
+  int ofs = line.indexOf("OFS=");
+  int ppm = line.indexOf("PPM=");
+  int tun = line.indexOf("TUN=");
+  if (ofs < 0 || ppm < 0 || tun < 0) return;
+  
+  picOffsetMs = line.substring(ofs + 4).toInt();
+  picPpm = line.substring(ppm + 4).toInt();
+  picOscTune = line.substring(tun + 4).toInt();
+  
+  if (labs(picOffsetMs) <= TIME_SYNC_GOOD_MS) {
+    timeSyncInterval = min(timeSyncInterval * 2, TIME_SYNC_MAX_MS);
+  } else {
+    timeSyncInterval = max(timeSyncInterval / 2, timeUpdateInterval);
+  }
 }
 
 String getSensorDataJson() {
@@ -1331,6 +2026,7 @@ String getSensorDataJson() {
   doc["lm35_temp"] = sensorData.lm35_temp;
   doc["hih_humid"] = sensorData.hih_humid;
   doc["light"] = sensorData.light;
+  doc["lux"] = sensorData.lux;
   doc["sht_temp"] = sensorData.sht_temp;
   doc["sht_humid"] = sensorData.sht_humid;
   doc["lm35_valid"] = sensorData.lm35_valid;
@@ -1338,6 +2034,12 @@ String getSensorDataJson() {
   doc["light_valid"] = sensorData.light_valid;
   doc["sht_temp_valid"] = sensorData.sht_temp_valid;
   doc["sht_humid_valid"] = sensorData.sht_humid_valid;
+  doc["sht_res_bits"] = sensorData.sht_res_bits;
+  if (sensorData.raw_valid) {
+    doc["raw_lm35_temp"] = sensorData.lm35_raw;
+    doc["raw_hih_humid"] = sensorData.hih_raw;
+    doc["raw_light"] = sensorData.light_raw;
+  }
   doc["last_update"] = sensorData.last_update;
   
   // Serialize JSON to string
@@ -1391,6 +2093,57 @@ void setupWebServer() {
     request->send(200, "application/json", json);
   });
   
+  // API endpoint for the PIC's latest diagnostic counters
+  server.on("/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String status = lastStatusLine;
+    status += "\nESP:baud=" + String(linkBaud) + ",pic_offset_ms=" + String(picOffsetMs) +
+              ",pic_ppm=" + String(picPpm) + ",pic_osctune=" + String(picOscTune) +
+              ",time_sync_s=" + String(timeSyncInterval / 1000) + ",frames_ok=" + String(framesOk) + ",frames_bad=" + String(framesBad) +
+              ",frames_lost=" + String(framesLost) + ",backfill_ok=" + String(backfillOk) +
+              ",backfill_no_time=" + String(backfillNoTime) + ",backfill_blocks=" + String(backfillBlocks) +
+              ",reports_full=" + String(reportsFull) + ",reports_partial=" + String(reportsPartial) +
+              ",reports_saved=" + String(reportsSaved) + ",report_s=" + String(picReportMs / 1000) +
+              ",cmd_last=" + (lastCommandReply.length() ? lastCommandReply : String("-"));
+    request->send(200, "text/plain", status);
+  });
+  
+  // Remote control of the PIC: display mode, alarm, report rate
+  server.on("/control", HTTP_GET, [](AsyncWebServerRequest *request) {
+    static const char *params[] = { "mode", "alarm", "rate" };
+    static const char *commands[] = { "MODE", "ALARM", "RATE" };
+    
+    for (int i = 0; i < 3; i++) {
+      if (!request->hasParam(params[i])) continue;
+      if (commandPending) {
+        request->send(503, "text/plain", "Busy");
+        return;
+      }
+      long value = request->getParam(params[i])->value().toInt();
+      snprintf(pendingCommand, sizeof(pendingCommand), "%s:%ld#%u\n", commands[i], value, ++commandSeq);
+      if (i == 2 && value >= 1 && value <= 30) picReportMs = value * 1000;
+      commandPending = true;
+      request->send(200, "application/json", "{\"seq\":" + String(commandSeq) + "}");
+      return;
+    }
+    request->send(400, "text/plain", "Expected mode, alarm or rate");
+  });
+  
+  // Stored samples, oldest slot first: [{"t":<unix>,"v":[...],"valid":<bits>},...]
+  // Values are tenths; entries replayed from the PIC log may be out of order.
+  server.on("/history", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    size_t first = (historyHead + HISTORY_SIZE - historyCount) % HISTORY_SIZE;
+    
+    response->print('[');
+    for (size_t i = 0; i < historyCount; i++) {
+      const HistoryEntry &e = history[(first + i) % HISTORY_SIZE];
+      response->printf("%s{\"t\":%lu,\"v\":[%d,%d,%d,%d,%d],\"valid\":%u}",
+                       i ? "," : "", (unsigned long)e.t, e.v[0], e.v[1], e.v[2], e.v[3], e.v[4], e.valid);
+    }
+    response->print(']');
+    request->send(response);
+  });
+  
   // Handle not found
   server.onNotFound([](AsyncWebServerRequest *request) {
     request->send(404, "text/plain", "Not found");
@@ -1427,6 +2180,10 @@ void parseJsonData(String jsonString) {
     sensorData.light_valid = true;
   }
   
+  if (doc.containsKey("lux")) {
+    sensorData.lux = doc["lux"];
+  }
+  
   if (doc.containsKey("sht_temp")) {
     if (doc["sht_temp"].is<float>()) {
       sensorData.sht_temp = doc["sht_temp"];
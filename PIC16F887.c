@@ -20,6 +20,66 @@
 #define HIH_CHANNEL  1          // Canal 1 pentru AN1
 #define LDR_CHANNEL  2          // Canal 2 pentru AN2
 
+// Achizitie ADC AN0..AN2 in intrerupere, cu supraesantionare: fiecare
+// canal primeste ADC_OVS_COUNT conversii la rand, deci ajunge un singur
+// acumulator. 4^n esantioane adauga n biti efectivi; acumulatorul de 16
+// biti permite pana la 64 de esantioane de 10 biti.
+#define ADC_NUM_CH       3
+#define ADC_OVS_SHIFT    4                          // 16 esantioane/canal (4..6)
+#define ADC_OVS_COUNT    (1U << ADC_OVS_SHIFT)
+#define ADC_EXTRA_BITS   (ADC_OVS_SHIFT / 2)        // Biti castigati
+#define ADC_DECIM_SHIFT  (ADC_OVS_SHIFT - ADC_EXTRA_BITS)
+#define ADC_FULL_SCALE   (1024UL << ADC_EXTRA_BITS) // 4096 pentru 12 biti
+
+// Conversiile senzorilor lucreaza in virgula fixa: temperaturi in zecimi
+// de grad, umiditate si lumina in zecimi de procent. USE_FLOAT_MATH = 1
+// pastreaza formulele float originale (pentru comparatie); cu 0 biblioteca
+// float a XC8 nu mai este legata deloc.
+#define USE_FLOAT_MATH   0
+
+// Constante precalculate pentru ADC_FULL_SCALE = 2^(10 + ADC_EXTRA_BITS)
+#define ADC_SCALE_SHIFT  (10 + ADC_EXTRA_BITS)
+#define LM35_MV_FS       5000UL     // 5V -> 5000mV; LM35: 1mV = 0.1C
+#define LDR_PERMILLE_FS  1000UL
+#define SHT21_T_GAIN     7029UL     // 1757.2 * 2^18 / 2^16
+#define SHT21_T_OFFSET   468        // 468.5, rotunjirea e inclusa
+#define SHT21_RH_GAIN    625UL      // 1250 * 2^15 / 2^16
+#define SHT21_RH_OFFSET  60
+
+// Umiditatea HIH-5030 compensata cu temperatura, din tabelul hih_rh_lut[]:
+// coloane la fiecare 1/8 din ADC_FULL_SCALE, randuri la 12.8C de la -40C
+// (pasul 128 de zecimi -> deplasare in loc de impartire)
+#define HIH_LUT_COLS     9
+#define HIH_LUT_ROWS     11
+#define HIH_LUT_CSHIFT   (ADC_SCALE_SHIFT - 3)
+#define HIH_LUT_T0       (-400)
+#define HIH_LUT_TSHIFT   7
+#define HIH_LUT_TMAX     (HIH_LUT_T0 + ((HIH_LUT_ROWS - 1) << HIH_LUT_TSHIFT) - 1)
+
+// Lux din LDR (tip GL5528: R10 = 15k la 10 lx, gamma = 0.7), legat la masa,
+// cu 10k spre Vcc. Din partea intunecata d = 1000 - L (promile din ADC):
+//   R = 10k * d / (1000 - d),  lux = 10 * (R10 / R)^(1/gamma)
+// In log2 (Q8) asta e o dreapta, calculata cu tabelele lux_log2[] si
+// lux_exp2[] (1/16 de octava, interpolate): fara log()/pow().
+#define LUX_LOG2_K       1064       // 256 * log2(10 * (15k / 10k)^(1/0.7))
+#define LUX_INV_GAMMA    366        // 256 / 0.7
+#define LUX_MAX          65535U     // Plafon (lumina directa a soarelui)
+
+// Filtrare pe canal dupa conversie, la 1 esantion/s: medie exponentiala
+// (o singura suma, constanta de timp de filt_len[] esantioane) sau mediana
+// din FILT_MEDIAN_N (anti-spike). Media e exponentiala, nu pe fereastra,
+// din cauza RAM-ului: o fereastra de 4 ar cere inca 6 B pe canal. Fiecare
+// canal are doar 2 valori de stare: suma si ultimul esantion brut,
+// respectiv ultimele doua esantioane brute. Ultimul esantion brut ramane
+// deci disponibil pentru raport (RAW:1).
+#define FILT_NONE        0
+#define FILT_AVG         1
+#define FILT_MEDIAN      2
+#define FILT_STATE       2
+#define FILT_MEDIAN_N    3          // Fix: starea tine FILT_MEDIAN_N - 1 esantioane
+#define FILT_AVG_MAX     4          // filt_len[] maxim: suma incape in int (CAL_OUT_MAX)
+#define REPORT_RAW_DEFAULT 0
+
 // Pinii pentru buzzer si butoane
 #define BUZZER_PIN  RA3         // Buzzer pe RA3
 #define BUTTON_PIN  RA4         // Buton alarma pe RA4
@@ -28,6 +88,22 @@
 #define LDR_BUTTON_PIN RB3      // Buton senzor lumina pe RB3
 #define TIME_BUTTON_PIN RB1     // Buton timp pe RB1
 
+// Butoane: indexii 0..3 = RB0..RB3 (intrerupere la schimbare), 4 = RA4
+// (fara IOC, esantionat la fiecare tick). Debounce prin integrator in
+// intreruperea Timer1; evenimentele intra intr-o coada fara blocare
+// (scrisa doar de ISR, citita doar de bucla principala).
+#define BTN_COUNT         5
+#define BTN_ALARM         4
+#define BTN_DEBOUNCE      3             // Tick-uri pentru o stare stabila (max. 3, 2 biti)
+#define BTN_LONG_TICKS    MS_TO_TICKS(1000)
+#define BTN_REPEAT_TICKS  MS_TO_TICKS(250)  // Dupa LONG, cat timp e tinut
+#define BTN_EV_NONE       0x00
+#define BTN_EV_PRESS      0x10          // Eveniment = tip | index buton
+#define BTN_EV_LONG       0x20
+#define BTN_EV_REPEAT     0x30
+#define BTN_QUEUE_SIZE    4             // Putere a lui 2; golita la fiecare tick
+#define BTN_QUEUE_MASK    (BTN_QUEUE_SIZE - 1)
+
 // Moduri de afisare
 #define DISP_WELCOME  0
 #define DISP_LM35     1
@@ -41,6 +117,21 @@
 #define SHT_SDA_DIR      TRISCbits.TRISC4
 #define SHT_SCL_DIR      TRISCbits.TRISC3
 
+// Driver I2C: I2C_USE_MSSP = 1 foloseste modulul MSSP (master hardware)
+// pe aceiasi pini RC3/RC4, la I2C_SPEED_KHZ (100 sau 400); 0 pastreaza
+// implementarea software (~50kHz). MSSP cere rezistente pull-up pe SDA si
+// SCL (varianta software comanda SCL direct).
+//
+// Timp de magistrala pentru o citire SHT21 completa (START, adresa,
+// 3 octeti, STOP = 36 de impulsuri de ceas), estimat:
+//   software ~765us, MSSP 100kHz ~380us, MSSP 400kHz (333kHz real) ~120us
+// O interogare NACK (START, adresa, STOP): ~270us / ~110us / ~40us.
+#define I2C_USE_MSSP     0
+#define I2C_SPEED_KHZ    100
+// Rotunjire in sus: 400kHz -> SSPADD = 2 (333kHz), nu 1 (500kHz)
+#define I2C_SSPADD       (((_XTAL_FREQ / 4000UL) + I2C_SPEED_KHZ - 1) / I2C_SPEED_KHZ - 1)
+#define I2C_WAIT_MAX     1000    // Limita pentru asteptarea MSSP (magistrala blocata)
+
 // Adresa I2C pentru SHT21
 #define SHT21_ADDRESS          0x40 // adresa pe 7 biti
 #define SHT21_ADDRESS_WRITE    (SHT21_ADDRESS << 1)
@@ -55,35 +146,298 @@
 #define SHT21_CMD_READ_USER_REG           0xE7
 #define SHT21_CMD_SOFT_RESET              0xFE
 
+// Masurare asincrona SHT21: comanda "no hold", apoi interogare la fiecare
+// tick a adresei de citire pana cand senzorul raspunde cu ACK
+#define SHT21_IDLE             0
+#define SHT21_WAIT_TEMP        1
+#define SHT21_WAIT_HUMID       2
+#define SHT21_BUSY             0xFF    // Senzorul inca masoara (NACK)
+#define SHT21_TIMEOUT_MARGIN   30      // ms peste maximul din foaia de catalog
+#define SHT21_CRC_ERROR        4       // Cadru cu CRC invalid
+#define SHT21_BUS_ERROR        5       // Coliziune sau timeout pe magistrala (MSSP)
+#define SHT21_MAX_RETRIES      2       // Remasurari permise dupa CRC invalid
+
+// CRC-8 SHT21: polinom x^8 + x^5 + x^4 + 1 (0x31), valoare initiala 0.
+// SHT21_CRC_NIBBLE = 1 foloseste un tabel de 16 intrari (2 cautari pe
+// octet) in loc de 256, pentru versiuni cu flash putin.
+#define SHT21_CRC_NIBBLE       0
+
+// Rezolutia SHT21 (registrul utilizator, bitii 7 si 0), ordonata dupa
+// precizie: fiecare nivel are T si RH cel putin la fel de fine ca cel
+// dinainte. Nivelul 0 = T12/RH8 (22+4ms), 2 = T14/RH12 (85+29ms).
+// T11/RH11 nu intra: fata de T12/RH8 castiga la RH, dar pierde la T.
+// La schimbari rapide se trece pe nivelul 0, apoi se urca cate un nivel
+// dupa SHT21_STABLE_CYCLES cicluri stabile.
+#define SHT21_RES_LEVELS       3
+#define SHT21_RES_MASK         0x81
+#define SHT21_STABLE_CYCLES    5
+#define SHT21_NO_READING       0xFF    // sht_stable_cycles: inca nicio citire
+#define SHT21_FAST_DELTA_T     5       // 0.5C intre doua cicluri
+#define SHT21_FAST_DELTA_RH    20      // 2.0%RH intre doua cicluri
+
 // Pinii pentru LCD
 #define RS RC0    // Register Select pe RC0
 #define EN RC1    // Enable pe RC1
 // D4-D7 sunt conectati la RD4-RD7
 
+// LCD_USE_BUSY_FLAG = 1: RW pe RC2, driverul citeste flag-ul BUSY (D7).
+// LCD_USE_BUSY_FLAG = 0: RW legat la GND, se asteapta timpul de executie
+// al fiecarei instructiuni conform foii de catalog HD44780.
+#define LCD_USE_BUSY_FLAG 0
+#define RW RC2    // Read/Write pe RC2 (doar cu LCD_USE_BUSY_FLAG)
+#define LCD_EXEC_US       50    // Scriere date / majoritatea comenzilor (37us)
+#define LCD_HOME_US       1600  // Clear display / return home (1.52ms)
+#define LCD_POLL_US       10    // Durata aproximativa a unei citiri BUSY
+#define LCD_POLL_MAX      250   // Limita de siguranta (~2.5ms)
+
+// Raport binar catre ESP32: cadru COBS delimitat de 0x00 la ambele capete.
+// Continut (inainte de COBS, little-endian):
+//   tip, secventa, bitmap valid (T1,H1,L,T2,H2), biti rezolutie T2,
+//   T1, H1, L, T2, H2 (int16, zecimi), lux (uint16), CRC-16/CCITT
+//   (0x1021, init 0xFFFF). Luxul insoteste L si in cadrele partiale.
+// Formatul text ramane disponibil pentru depanare (comanda FMT:T / FMT:B).
+#define REPORT_PERIOD_MS       5000     // Implicit; RATE:<s> il schimba
+#define REPORT_RATE_MIN_S      1
+#define REPORT_RATE_MAX_S      30       // Heartbeat-ul trebuie sa prinda LINK_TIMEOUT_MS
+#define REPORT_BINARY_DEFAULT  0
+#define FRAME_SAMPLE           0x01
+#define FRAME_SAMPLE_LEN       18
+#define FRAME_SAMPLE_RAW       0x02     // Ca FRAME_SAMPLE + T1, H1, L brute
+#define FRAME_SAMPLE_RAW_LEN   24
+#define FRAME_UPDATE           0x03     // tip, secventa, bitmap canale, int16..., [lux], CRC
+#define FRAME_UPDATE_MAX       (3 + 2 * REPORT_NUM_FIELDS + 2 + 2)
+#define FRAME_COBS_MAX         (FRAME_SAMPLE_RAW_LEN + 3)  // Octetul COBS si cei doi delimitatori
+
+// Raport prin banda moarta: la fiecare rulare se trimit doar canalele care
+// s-au miscat cu cel putin rep_deadband[] fata de ultima valoare trimisa
+// (UPD:... / FRAME_UPDATE); nimic daca nu s-a schimbat nimic. Raportul
+// complet pleaca la fiecare REPORT_HEARTBEAT_MS, imediat ce se schimba
+// validitatea unui senzor si dupa comenzile FMT:.
+#define REPORT_ALL             0x1F
+#define REPORT_HEARTBEAT_MS    15000
+// Liniile text au pana la 57 de caractere (raportul complet) si 33 (RAW),
+// cu T1, H1, L la -819.1 / -819 dupa calibrare; sunt mai lungi decat
+// coada de transmisie si pleaca pe bucati (Report_TextPart).
+#define REPORT_NUM_FIELDS      5
+#define REPORT_T2              3        // Dupa canalele ADC (T1, H1, L)
+#define REPORT_H2              4
+#define REPORT_MOVE_MAX        127      // Saturatia lui rep_move[] (> orice banda moarta)
+#define CRC16_POLY             0x1021
+#define CRC16_INIT             0xFFFF
+
+// Jurnal de esantioane in EEPROM-ul de date (256 octeti), pentru cand
+// ESP32 lipseste:
+//   0x00..0xBF  jurnal circular, LOG_SLOTS blocuri de 64 octeti
+//   0xC0..0xC7  rezervat
+//   0xC8..0xFF  calibrare
+// Bloc: flags, seq, epoca primului esantion (s de la 2000, LE), cadrul
+// cheie T1, H1, L, T2, H2 (int16 LE), apoi esantioanele urmatoare, din
+// LOG_STEP_S in LOG_STEP_S, cate o cifra hexa pe canal (cea mai
+// semnificativa intai):
+// diferenta fata de cadrul cheie + 7 (0..13, deci -7..6), sau 14 urmat
+// de valoarea intreaga pe 4 cifre. Cifra 15 (EEPROM sters) incheie sirul:
+// numarul de esantioane se deduce din date, nu se rescrie la fiecare
+// esantion. Un esantion cu toate diferentele in -7..6 ocupa 2.5 octeti in
+// loc de 10, o diferenta mai mare inca 2 octeti; un bloc tine cel mult 20
+// esantioane (cadrul cheie + 19).
+// flags = 0xFF: slot gol; bitii 0..4 = valid, bit 6 = ora nesincronizata,
+// bit 7 = confirmat de ESP32. Capetele nu se tin in EEPROM: la pornire se
+// reconstruiesc din numerele de secventa, iar confirmarea se scrie in
+// blocul insusi, deci toate sloturile se uzeaza la fel.
+#define EE_LOG_BASE       0x00
+#define EE_CAL_BASE       0xC8
+
+// Calibrarea canalelor analogice T1, H1, L (SHT21 e calibrat din fabrica),
+// cate CAL_REC_SIZE octeti de la EE_CAL_BASE:
+//   marcaj (CAL_VALID), offset (int16, zecimi), castig (int16, Q12:
+//   4096 = 1.0), numarul de puncte, apoi pana la CAL_MAX_POINTS puncte
+//   x (int16, zecimi) + corectie (int8, zecimi), crescator dupa x.
+// v' = v * castig / 4096 + offset, apoi se adauga corectia interpolata
+// liniar intre puncte (constanta in afara lor). Marcajul se scrie ultimul.
+#define CAL_CHANNELS      3
+#define CAL_REC_SIZE      18
+#define CAL_MAX_POINTS    3
+#define CAL_MAX_VALUE     9999      // |offset| si |x|, zecimi
+#define CAL_VALID         0x5A
+#define CAL_GAIN_ONE      4096
+#define CAL_GAIN_MIN      2048      // 0.5
+#define CAL_GAIN_MAX      8192      // 2.0: v * castig + offset incape in int
+#define CAL_OUT_MAX       8191      // |v'|, zecimi (filtrul tine FILT_AVG_MAX * v')
+#define CAL_OFS_OFFSET    1
+#define CAL_OFS_GAIN      3
+#define CAL_OFS_NPTS      5
+#define CAL_OFS_PTS       6
+#define CAL_REC_USED      (CAL_OFS_PTS + 3 * CAL_MAX_POINTS)  // Restul e rezerva
+#define EE_WR_IDLE        0xFF
+#define EE_STAGE_SIZE     16        // Antetul unui bloc de jurnal (LOG_OFS_DATA)
+#define LOG_SLOTS         3
+#define LOG_BLK_SIZE      64
+#define LOG_OFS_FLAGS     0
+#define LOG_OFS_SEQ       1
+#define LOG_OFS_EPOCH     2
+#define LOG_OFS_KEY       6
+#define LOG_OFS_DATA      16
+#define LOG_DATA_NIBS     ((LOG_BLK_SIZE - LOG_OFS_DATA) * 2)
+#define LOG_NIB_BIAS      7         // Cifra = diferenta + 7
+#define LOG_NIB_ESC       0x0E
+#define LOG_NIB_END       0x0F
+#define LOG_STEP_S        60        // Un esantion pe minut (divide 60)
+#define LOG_LATE_S        5         // Cat poate intarzia Task_Second in pas
+#define LOG_F_EMPTY       0xFF
+#define LOG_F_NOTIME      0x40
+#define LOG_F_ACKED       0x80
+#define LOG_NONE          0xFF
+#define LINK_TIMEOUT_MS   35000     // Fara RXOK atat timp (2 heartbeat-uri): ESP32 absent
+#define LOG_BF_TIMEOUT_MS 1000      // Asteptarea BFACK inainte de retransmisie
+#define LOG_BF_TRIES      3
+#define LOG_BF_CHUNK      8         // Octeti de bloc pe o linie BF:
+#define LOG_BF_LINE_MAX   31        // "BF:255,64,56,<16 cifre hexa>\r\n"
+
+// Framebuffer LCD 16x2
+#define LCD_ROWS   2
+#define LCD_COLS   16
+#define LCD_CELLS  (LCD_ROWS * LCD_COLS)
+#define LCD_DIRTY  0x80
+
 // Pinii pentru UART
 #define UART_TX_PIN  RC6       // UART TX pe RC6
 #define UART_RX_PIN  RC7       // UART RX pe RC7
 
+// Viteza UART negociata cu ESP32. Ambele parti pornesc la 9600; ESP32
+// propune BAUD:<rata>, PIC raspunde BAUD:ACK (sau BAUD:NAK) si trece pe
+// noua rata dupa ce raspunsul a iesit complet. ESP32 trimite apoi un
+// model de test (SYNC:...) pe care PIC il trimite inapoi neschimbat;
+// BAUD:OK fixeaza rata. Fara BAUD:OK in UART_TRIAL_MS, sau dupa
+// UART_ERR_MAX erori de receptie intr-o secunda, PIC revine la 9600.
+// BRG16 = 1, BRGH = 1: baud = Fosc / (4 * (SPBRG + 1)).
+#define UART_NUM_BAUDS     5
+#define UART_BAUD_DEFAULT  0        // 9600
+#define UART_TRIAL_MS      2000
+#define UART_ERR_MAX       8
+#define UART_BAUD_FIXED    0
+#define UART_BAUD_PENDING  1        // BAUD:ACK inca in coada
+#define UART_BAUD_TRIAL    2        // Rata noua, asteapta BAUD:OK
+
+// Mod de consum redus: cand niciun task nu e scadent, nucleul intra in
+// SLEEP. Timer1 (din ceasul intern) se opreste in SLEEP, iar cristalul de
+// 32kHz pentru T1OSC ar ocupa RC0/RC1 (RS/EN la LCD), deci trezirea
+// periodica vine de la WDT (LFINTOSC, ~31kHz). Butoanele RB0..RB3 trezesc
+// prin IOC, UART-ul prin WUE (ESP32 trimite un '\n' inaintea comenzilor).
+// Tick-urile dormite se adauga la ceas la trezire; perioada WDT are
+// toleranta mare, asa ca e recalibrata din sincronizarile de timp.
+#define LOW_POWER        0
+#define LP_WDTPS_MIN     5          // 1:1024, ~33ms
+#define LP_WDTPS_MAX     10         // 1:32768, ~1.06s
+#define LP_WDT_Q12       423        // WDT 1:32 la 31kHz = 0.103 tick-uri (Q12)
+#define LP_ADC_ACQ_US    5          // Achizitia intre conversiile unei rafale
+
+// Ceas de timp real: campuri binare, avansate din intreruperea Timer1.
+// Anul e memorat fata de 2000 (anul bisect = divizibil cu 4, valabil
+// pana in 2099). Textul se formeaza doar la afisare.
+typedef struct {
+    unsigned char sec, min, hour;
+    unsigned char day, month, year;     // 1..31, 1..12, 0..99
+} rtc_t;
+
+// O linie de comanda analizata de Cmd_Parse; numerele sunt in argv-ul
+// din Cmd_Execute
+typedef struct {
+    unsigned char idx;          // In cmds[]; NUM_CMDS = necunoscuta
+    unsigned char argc, text;   // Numere gasite, inceputul textului brut
+    unsigned char err;          // CMD_ERR_ARGS daca un numar nu incape in int
+    unsigned char seq_pos;      // Pozitia lui '#' sau CMD_NO_SEQ (Cmd_Seq)
+} cmd_line_t;
+
 // Declararea functiilor
 void setupPins(void), LCD_Command(unsigned char cmd), LCD_Init(void);
 void LCD_Char(unsigned char data), LCD_String(const char *str);
-unsigned int readADC(unsigned char channel);
-void setupADC(void), LCD_WriteTemp(float temp), LCD_WriteInt(int value);
-void I2C_Init(void), I2C_Start(void), I2C_Stop(void);
-unsigned char I2C_Write(unsigned char data), I2C_Read(unsigned char send_ack);
+void LCD_Write(unsigned char value, unsigned char rs);
+void LCDFB_Init(void), LCDFB_Goto(unsigned char row, unsigned char col), LCDFB_Char(unsigned char c);
+void LCDFB_String(const char *str), LCDFB_ClearEOL(void), LCDFB_Flush(void);
+unsigned int ADC_Get(unsigned char channel);
+void setupADC(void), LCD_WriteTemp(int temp), LCD_WriteInt(int value), LCD_WriteUInt(unsigned int value);
+void I2C_Init(void);
+unsigned char I2C_Start(void), I2C_Restart(void), I2C_Stop(void), I2C_Wait(void);
+unsigned char I2C_Write(unsigned char data), I2C_Read(unsigned char send_ack, unsigned char *data);
 void SHT21_Init(void);
-unsigned char SHT21_Measure(unsigned char cmd, unsigned int *value);
-float SHT21_CalcTemperature(unsigned int rawValue), SHT21_CalcHumidity(unsigned int rawValue);
-float getLM35Temperature(void), getHIH5030Humidity(void), getLDRValue(void);
-unsigned char isButtonPressed(unsigned char pin);
+unsigned char SHT21_StartMeasure(unsigned char cmd), SHT21_ReadResult(unsigned int *value);
+unsigned char SHT21_CRC8(unsigned char msb, unsigned char lsb);
+unsigned char SHT21_SetResolution(unsigned char level);
+void SHT21_AdaptResolution(int new_temp, int new_humid);
+void SHT21_BeginCycle(void);
+int SHT21_CalcTemperature(unsigned int rawValue), SHT21_CalcHumidity(unsigned int rawValue);
+int getLM35Temperature(void), getHIH5030Humidity(int temp), getLDRValue(void);
+int Lux_Log2(unsigned int x);
+unsigned int Light_Lux(int light);
+int Filter_Update(unsigned char ch, int raw), Filter_Raw(unsigned char ch);
+int Report_Track(unsigned char i, int old, int now);
+unsigned char Cal_ReplyPart(unsigned char part);
+void Cal_Stage(unsigned char ch);
+int Cal_Apply(unsigned char ch, int value), Cal_Correction(unsigned char addr, unsigned char n, int value);
+unsigned char Cal_Points(unsigned char base);
+int EE_ReadInt(unsigned char addr);
+void Filter_Advance(void);
+void Buttons_Scan(void), Buttons_Push(unsigned char ev);
+unsigned char Buttons_GetEvent(void);
 void soundBuzzer(unsigned int duration_ms), displayAlarmCountdown(unsigned int seconds);
 void displayLoadingBar(unsigned int duration_ms), setupUART(void);
 void UART_SendByte(unsigned char data), UART_SendString(const char *str);
-void UART_SendFloat(float value, unsigned char precision);
-void setupTimer1(void), incrementTime(void), processUARTData(void);
+void UART_SendFixed(int value, unsigned char precision), UART_SendUInt(unsigned int value);
+void UART_SendInt(int value), UART_SendULong(unsigned long value);
+unsigned char EE_Read(unsigned char addr);
+void EE_StartWrite(unsigned char addr, unsigned char data);
+void Log_Init(void), Log_Append(void), Log_Service(void), Log_SendChunk(void);
+void EE_Write(unsigned char addr, unsigned char len, unsigned char clear);
+void EE_Service(void);
+void Log_PutNibble(unsigned char *st, unsigned char *pos, unsigned char nib);
+unsigned char Log_NextPending(void), Log_BlockLen(unsigned char base);
+unsigned char Log_Nibble(unsigned char base, unsigned char nib), Log_Scan(unsigned char base, unsigned char *nibs);
+unsigned char Log_StepOf(unsigned char base, unsigned long epoch);
+unsigned int Log_Pending(void);
+void Link_Alive(void);
+void UART_SendCOBS(const unsigned char *buf, unsigned char len);
+unsigned int CRC16_Update(unsigned int crc, unsigned char data);
+void Report_SendBinary(unsigned char mask, unsigned int lux);
+unsigned char Report_TextPart(unsigned char part);
+int Report_Value(unsigned char i);
+unsigned char Report_Valid(void), Report_Select(void);
+unsigned char UART_TxFree(void), UART_Reserve(unsigned char len), UART_Commit(void);
+unsigned char UART_SendParts(unsigned char owner, unsigned char (*part)(unsigned char));
+void UART_SetBaud(unsigned char idx), UART_RequestBaud(unsigned char arg), UART_Fallback(void);
+void setupTimer1(void), processUARTData(void);
+void RTC_Tick(void), RTC_Set(const rtc_t *in, unsigned char ticks);
+unsigned char RTC_Get(rtc_t *out);
+unsigned long RTC_ToEpoch(const rtc_t *t);
+void Time_Discipline(long ofs);
+unsigned int Time_SyncAge(void);
+unsigned char Time_SyncPart(unsigned char part);
+signed char Time_Tune(void);
+void Time_SetCorrection(int ppm);
+int Time_Correction(void);
+void RTC_FormatTime(const rtc_t *t, char *buf), RTC_FormatDate(const rtc_t *t, char *buf);
+unsigned char RTC_SetDate(rtc_t *t, const int *argv);
 void __interrupt() timer_isr(void);
-unsigned char my_strlen(const char* str);
-char* my_strstr(const char* haystack, const char* needle);
+unsigned int getTicks(void);
+void Scheduler_Init(void), Scheduler_Run(void), Scheduler_Trigger(unsigned char task);
+void Task_Tick(void), Task_Buttons(void), Task_Second(void), Task_Sample(void), Task_LCD(void);
+void Task_Report(void), Task_Alarm(void), Task_Stats(void), Task_SHT21(void), Task_Link(void);
+unsigned char Stats_SendField(unsigned char field);
+unsigned int Scheduler_IdleTicks(void);
+unsigned char LP_CanSleep(void);
+void LP_Idle(void);
+unsigned char Cmd_Execute(unsigned char line), Cmd_ReplyPart(unsigned char part);
+void Cmd_SendReply(void);
+void Cmd_Parse(unsigned char line, int *argv, cmd_line_t *cmd);
+unsigned int Cmd_Seq(unsigned char p);
+unsigned char Cmd_NameIs(const char *name, unsigned char pos, unsigned char len);
+unsigned char Cmd_Time(const int *argv, unsigned char argc, unsigned char text), Cmd_Date(const int *argv, unsigned char argc, unsigned char text);
+unsigned char Cmd_Rate(const int *argv, unsigned char argc, unsigned char text), Cmd_Mode(const int *argv, unsigned char argc, unsigned char text);
+unsigned char Cmd_Alarm(const int *argv, unsigned char argc, unsigned char text), Cmd_Cal(const int *argv, unsigned char argc, unsigned char text);
+unsigned char Cmd_CalPoints(const int *argv, unsigned char argc, unsigned char text), Cmd_Ping(const int *argv, unsigned char argc, unsigned char text);
+unsigned char Cmd_Fmt(const int *argv, unsigned char argc, unsigned char text), Cmd_Raw(const int *argv, unsigned char argc, unsigned char text);
+unsigned char Cmd_Baud(const int *argv, unsigned char argc, unsigned char text), Cmd_Sync(const int *argv, unsigned char argc, unsigned char text);
+unsigned char Cmd_RxOk(const int *argv, unsigned char argc, unsigned char text), Cmd_Backfill(const int *argv, unsigned char argc, unsigned char text);
+unsigned char Cmd_BfAck(const int *argv, unsigned char argc, unsigned char text), Cmd_Stat(const int *argv, unsigned char argc, unsigned char text);
 
 // Stringuri pentru afisare
 const char welcome1[] = "Apasa un buton";
@@ -91,19 +445,364 @@ const char welcome2[] = "pentru meniu";
 const char alarm_txt[] = "Alarma: ";
 const char alarm_add[] = "+ Apasa pt 15s";
 
-// Variabile globale
-char time_str[9] = "00:00:00", date_str[11] = "01/01/2024";
-unsigned char time_valid = 0, uart_index = 0, uart_data_ready = 0;
-char uart_buffer[64] = "";
-volatile unsigned char timer1_count = 0;
-// Valori pentru Timer1 - intrerupere la ~0.1 secunde
-#define TMR1_PRELOAD_H 0xCF
-#define TMR1_PRELOAD_L 0x2C
+// Variabile globale. Fiecare modul isi noteaza RAM-ul static ("RAM: n B");
+// indicatorii da/nu sunt __bit (XC8 ii strange cate 8 intr-un octet,
+// pornesc de la 0) si se noteaza separat ("+ n biti").
+// Bugetul PIC16F887 e de 368 B, cu tot cu stiva compilata:
+//   static           ~283 B (cu 17 biti = 3 B; LOW_POWER ~292 B)
+//   bucla principala  ~58 B (cel mai adanc lant: TIME, Cmd_Execute >
+//                     Cmd_Time > Time_Discipline > impartire pe 32 de
+//                     biti, sau jurnalul, Scheduler_Run > Task_Second >
+//                     Log_Append > RTC_ToEpoch > inmultire pe 32 de biti)
+//   ISR               ~19 B (cu salvarea contextului)
+//   rezerva            ~8 B (LOW_POWER fara rezerva)
+// Stiva e o estimare, cu USE_FLOAT_MATH 0; valorile exacte le da sumarul
+// de memorie XC8 (--summary=mem). Ce se adauga intra in rezerva sau
+// elibereaza tot atata.
+
+// Ceasul. RAM: 7 B + 1 bit
+volatile rtc_t rtc = { 0, 0, 0, 1, 1, 24 };   // 00:00:00 01/01/2024
+const unsigned char rtc_month_days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+__bit time_valid;                               // Ora a venit de la ESP32
+volatile unsigned char timer1_count = 0;        // Tick-uri in secunda curenta
+
+// log2(1 + i/16) si 2^(i/16), pentru Light_Lux (Q8 / Q14)
+const unsigned int lux_log2[17] = {
+    0, 22, 44, 63, 82, 100, 118, 134, 150, 165, 179, 193, 207, 220, 232, 244, 256
+};
+const unsigned int lux_exp2[17] = {
+    16384, 17109, 17867, 18658, 19484, 20347, 21247, 22188,
+    23170, 24196, 25268, 26386, 27554, 28774, 30048, 31379, 32768
+};
+
+#if !USE_FLOAT_MATH
+// RH adevarat [0.01%] = RH senzor / (1.0546 - 0.00216 * T), cu RH senzor
+// din Vout/Vs la capetele fiecarei coloane. In ADC dependenta e liniara,
+// deci interpolarea pe coloane e exacta; eroarea ramane curbura in T.
+// Tabelul se recalculeaza si se verifica cu tests/hih_lut_test.c.
+const int hih_rh_lut[HIH_LUT_ROWS][HIH_LUT_COLS] = {
+    {-2088,  -365,  1357,  3080,  4802,  6525,  8247,  9970, 11693},   // -40.0C
+    {-2140,  -374,  1391,  3156,  4922,  6687,  8452, 10218, 11983},   // -27.2C
+    {-2194,  -384,  1426,  3237,  5047,  6857,  8668, 10478, 12288},   // -14.4C
+    {-2251,  -394,  1464,  3321,  5179,  7036,  8894, 10752, 12609},   // -1.6C
+    {-2312,  -404,  1503,  3410,  5318,  7225,  9133, 11040, 12947},   // +11.2C
+    {-2376,  -416,  1544,  3504,  5464,  7424,  9384, 11344, 13304},   // +24.0C
+    {-2443,  -427,  1588,  3604,  5619,  7635,  9651, 11666, 13682},   // +36.8C
+    {-2514,  -440,  1635,  3709,  5783,  7858,  9932, 12007, 14081},   // +49.6C
+    {-2590,  -453,  1684,  3820,  5957,  8094, 10231, 12367, 14504},   // +62.4C
+    {-2670,  -467,  1736,  3939,  6142,  8345, 10548, 12751, 14954},   // +75.2C
+    {-2755,  -482,  1791,  4065,  6338,  8612, 10885, 13158, 15432}    // +88.0C
+};
+#endif
+
+// Disciplinarea ceasului. Fiecare TIME de la ESP32 (dupa primul) da
+// abaterea ceasului PIC fata de NTP; impartita la intervalul dintre
+// sincronizari, e eroarea ramasa a oscilatorului in ppm. Corectia fina
+// e un acumulator de faza in ISR: tick-urile se scurteaza/lungesc cu cate
+// o numarare Timer1 (800ppm dintr-un tick), deci rezolutia e 1ppm. Peste
+// TIME_OSCTUNE_PPM se muta si OSCTUNE cu un pas, ceea ce corecteaza si
+// rata UART. Corectia absoarbe si latenta fixa a reincarcarii Timer1.
+// Intervalul il numara ISR-ul, in secunde. RAM: 7 B
+#define TIME_MIN_INTERVAL  30       // s intre sincronizari pentru o masurare
+#define TIME_MAX_OFS_MS    1800000L // Abatere mai mare = ora schimbata, nu deriva
+#define TIME_MAX_PPM       30000    // Limita corectiei (oscilator +/-2% + rezerva)
+#define TIME_AGE_MAX       0xFFFF   // ~18h fara TIME: intervalul nu mai e cunoscut
+#define TIME_OSCTUNE_PPM   8000
+#define OSCTUNE_STEP_PPM   4000     // Pasul OSCTUNE, estimat (~0.4%)
+volatile unsigned int time_sync_age = TIME_AGE_MAX;  // s de la ultima sincronizare
+volatile signed char tmr1_trim = 0;     // Numarari intregi adaugate pe tick
+volatile unsigned int tmr1_frac = 0;    // Restul corectiei, 0..799 ppm
+unsigned int tmr1_phase = 0;            // Acumulatorul de faza (doar ISR)
+
+// Butoane - integratoarele si starea sunt folosite doar in ISR. Apasarea
+// lunga si repetarea sunt ale ultimului buton apasat. Integratoarele
+// (0..BTN_DEBOUNCE) sunt pe doua planuri de biti, un bit pe buton.
+// RAM: 13 B + 1 bit
+unsigned char btn_integ_lo = 0, btn_integ_hi = 0;
+unsigned char btn_held = 0;             // Ultimul buton apasat
+unsigned char btn_hold = 0;             // Tick-uri de cand e tinut apasat
+unsigned char btn_state = 0;            // Bit = buton apasat (dupa debounce)
+unsigned char btn_edges = 0;            // Apasari vazute de IOC intre tick-uri
+volatile __bit btn_busy;               // Un buton e apasat sau in debounce
+volatile unsigned char btn_queue[BTN_QUEUE_SIZE];
+volatile unsigned char btn_q_head = 0;  // Scris doar din ISR
+volatile unsigned char btn_q_tail = 0;  // Scris doar din bucla principala
+unsigned char btn_q_overflow = 0;       // Evenimente pierdute (coada plina)
+
+// Copie in RAM a ecranului. Fiecare celula e scrisa o data pe cadru;
+// bitul 7 (LCD_DIRTY) marcheaza celulele care difera de ce arata panoul
+// (textul afisat e ASCII). RAM: 37 B
+char lcd_fb[LCD_CELLS];
+unsigned char lcd_pos = 0;          // Cursorul de scriere in framebuffer
+unsigned int lcd_writes = 0;        // Octeti trimisi de la ultimul STAT
+unsigned int lcd_wait = 0;          // Timp total de asteptare (zeci de us, max. 0xFFFF)
+
+// Buffer circular de transmisie UART, golit din intreruperea TX. 32 de
+// octeti: liniile scurte (ACK, BF:, cadrul binar, ecoul SYNC) incap
+// intregi. O linie se scrie dupa uart_tx_head si ajunge la ISR abia la
+// UART_Commit, intreaga; daca nu a incaput e aruncata toata. Cine trimite
+// cere loc inainte (UART_Reserve) si asteapta. Liniile mai lungi decat
+// coada (raportul text, STAT, raspunsurile comenzilor) pleaca pe bucati
+// (UART_SendParts); pana la ultima bucata coada e a lor (uart_tx_owner).
+// RAM: 39 B + 1 bit
+#define UART_TX_SIZE   32                   // Putere a lui 2
+#define UART_TX_MASK   (UART_TX_SIZE - 1)
+#define UART_PART_MAX  20                   // Cea mai lunga bucata (",SHTT=65535/65535")
+#define UART_OWNER_NONE    0                // uart_tx_owner: nicio linie pe bucati
+#define UART_OWNER_STAT    1
+#define UART_OWNER_REPORT  2
+#define UART_OWNER_REPLY   3
+unsigned char uart_tx_buf[UART_TX_SIZE];
+unsigned char uart_tx_head = 0;             // Capatul liniilor publicate (bucla principala)
+unsigned char uart_tx_wr = 0;               // Capatul liniei in curs
+volatile unsigned char uart_tx_tail = 0;    // Scris doar din ISR
+__bit uart_tx_drop;                         // Linia in curs nu a incaput
+unsigned char uart_tx_owner = UART_OWNER_NONE;  // Linia trimisa pe bucati
+unsigned char uart_tx_part = 0;             // Urmatoarea ei bucata
+unsigned char uart_tx_hwm = 0;              // Nivel maxim atins
+unsigned char uart_tx_overflow = 0;         // Linii aruncate (nu au incaput, max. 255)
+
+// Buffer circular de receptie UART: ISR-ul pune octetii si inlocuieste
+// CR/LF cu un terminator, bucla principala interpreteaza liniile direct
+// din buffer. O linie care pierde octeti (buffer plin, FERR, OERR) se
+// termina cu UART_RX_BAD si e aruncata intreaga, nu trunchiata.
+// 48 de octeti: cea mai lunga linie acceptata, CALP cu trei puncte si
+// #secventa (45 de caractere), incape cu tot cu terminator. Nu e putere
+// a lui 2, deci indicii se intorc prin comparatie. RAM: 55 B + 1 bit
+#define UART_RX_SIZE   48                   // Linii de cel mult 46 de caractere
+#define UART_RX_BAD    0x01                 // Terminator de linie pierduta
+#define UART_RX_NEXT(i)   ((unsigned char)((i) + 1U) == UART_RX_SIZE ? 0 : (unsigned char)((i) + 1U))
+#define UART_RX_PREV(i)   ((i) ? (unsigned char)((i) - 1U) : UART_RX_SIZE - 1U)
+#define UART_RX_PARTIAL() (uart_rx_buf[UART_RX_PREV(uart_rx_head)] > UART_RX_BAD)
+unsigned char uart_rx_buf[UART_RX_SIZE];
+volatile unsigned char uart_rx_head = 0;    // Scris doar din ISR
+unsigned char uart_rx_tail = 0;             // Scris doar din bucla principala
+volatile unsigned char uart_rx_lines = 0;   // Linii terminate (ISR)
+unsigned char uart_rx_done = 0;             // Linii interpretate
+volatile __bit uart_rx_bad;                // Linia curenta a pierdut octeti
+volatile unsigned char uart_rx_overrun = 0; // OERR
+volatile unsigned char uart_rx_framing = 0; // FERR
+volatile unsigned char uart_rx_lost = 0;    // Linii aruncate
+
+// Ratele suportate, in zeci de baud (115200 nu incape pe 16 biti), si
+// divizorul BRG. Eroare fata de nominal: +0.2/+0.2/+0.2/+2.1/-3.5%;
+// 115200 e la limita, testul SYNC decide daca legatura e sigura.
+// RAM: 7 B
+const unsigned int uart_baud_div10[UART_NUM_BAUDS] = { 960, 1920, 3840, 5760, 11520 };
+const unsigned char uart_baud_brg[UART_NUM_BAUDS]  = { 103, 51, 25, 16, 8 };
+unsigned char uart_baud = UART_BAUD_DEFAULT;    // Rata activa (index)
+unsigned char uart_baud_next = UART_BAUD_DEFAULT;
+unsigned char uart_baud_state = UART_BAUD_FIXED;
+unsigned char uart_baud_since = 0;              // Tick-ul schimbarii de rata (TICKS8)
+unsigned char uart_err_window = 0;              // Inceputul ferestrei de erori (TICKS8)
+volatile unsigned char uart_rx_errors = 0;      // Erori de cadru/depasire (ISR)
+unsigned char uart_fallbacks = 0;               // Reveniri automate la 9600
+
+// Stare achizitie ADC - acumulatorul e folosit doar in ISR.
+// RAM: 10 B + 2 biti
+unsigned int adc_acc = 0;
+volatile unsigned int adc_result[ADC_NUM_CH];   // Rezultate decimate
+unsigned char adc_ch = 0, adc_count = 0;
+volatile __bit adc_ready;                       // Primul set decimat e gata
+__bit sample_late;                              // Esantionul asteapta EEPROM-ul (Task_Tick)
+                                                // (LOW_POWER: setul rafalei)
+
+#if LOW_POWER
+// Consum redus: calibrarea WDT si contoarele de somn. RAM: 9 B
+unsigned int lp_wdt_q12 = LP_WDT_Q12;   // Perioada WDT 1:32 calibrata (tick-uri Q12)
+unsigned int lp_credit_frac = 0;        // Fractiune de tick nerecuperata (Q12)
+unsigned int lp_slept_sync = 0;         // Dormit de la ultima sincronizare (TICKS64, ~11h)
+unsigned int lp_slept_stat = 0;         // Tick-uri dormite de la ultimul STAT
+unsigned char lp_stat_tick = 0;         // Inceputul ferestrei STAT (TICKS64)
+#endif
+
+volatile unsigned int sys_tick = 0;    // Tick-uri de 10ms de la pornire
+// Valori pentru Timer1 - intrerupere la 10ms (1250 numarari la 1MHz/8)
+#define TMR1_PRELOAD   0xFB1E
+#define TMR1_PRELOAD_H (TMR1_PRELOAD >> 8)
+#define TMR1_PRELOAD_L (TMR1_PRELOAD & 0xFF)
+#define TMR1_PPM_PER_COUNT 800      // O numarare din 1250 pe tick
+#define TICK_MS        10
+#define TICKS_PER_SEC  100
+#define MS_TO_TICKS(ms) ((unsigned int)((ms) / TICK_MS))
+// Octetul de jos al lui sys_tick se citeste atomic, fara getTicks(): ajunge
+// pentru marcaje de timp mai scurte de 2.55s
+#define TICKS8()        ((unsigned char)sys_tick)
+#define TICKS8_SINCE(t) ((unsigned char)(TICKS8() - (t)))
+// Marcaje grosiere pe un octet, in pasi de 64 de tick-uri (0.64s), pentru
+// intervale de zeci de secunde (pana la ~160s)
+#define TICKS64()         ((unsigned char)(getTicks() >> 6))
+#define TICKS64_SINCE(t)  ((unsigned char)(TICKS64() - (t)))
+#define MS_TO_TICKS64(ms) ((unsigned char)((ms) / (TICK_MS * 64UL)))
+
+// Comenzi de la ESP32, una pe linie: NUME[:argumente][#secventa]. Numele
+// se cauta in tabela cmds[], argumentele numerice se extrag intr-o singura
+// trecere (orice alt caracter le separa, cuvinte ca DATE se sar), iar
+// comenzile CMD_TEXT primesc textul brut. Cu #<n> raspunsul este ACK:<n>
+// sau NACK:<n>,<eroare>; fara secventa, comanda nu primeste raspuns.
+// Comenzile se executa imediat; raspunsul (linia handler-ului, apoi
+// ACK/NACK) asteapta loc in coada de transmisie (cmd_reply).
+#define CMD_MAX_ARGS     7          // TIME cu data, CALP cu 3 puncte
+#define CMD_TEXT         0xFF       // max_args: handler-ul citeste textul
+#define CMD_OK           0
+#define CMD_ERR_UNKNOWN  1
+#define CMD_ERR_ARGS     2
+#define CMD_ERR_BUSY     3
+#define CMD_NO_SEQ       0xFF       // cmd_line_t.seq_pos: linia nu are #secventa
+#define CMD_REPLY_NONE   0          // cmd_reply: nicio linie in asteptare
+#define CMD_REPLY_TSYNC  1          // TSYNC dupa TIME (Time_SyncPart)
+#define CMD_REPLY_CAL    2          // CAL:<canal>,... (Cal_ReplyPart)
+#define CMD_REPLY_LOG    3          // LOG:<n> la revenirea legaturii
+#define CMD_REPLY_PENDING() (cmd_reply != CMD_REPLY_NONE || cmd_ack)
+#define NUM_CMDS         16
+#define ALARM_MAX_S      999
+
+// Taskuri planificate (indexi in tabela de taskuri)
+#define TASK_TICK     0             // Butoane, SHT21 si legatura UART (Task_Tick)
+#define TASK_SECOND   1             // Alarma si esantionarea (Task_Second)
+#define TASK_LCD      2
+#define TASK_REPORT   3
+#define TASK_STATS    4
+#define NUM_TASKS     5
+
+typedef struct {
+    void (*run)(void);
+    unsigned int period;        // Perioada in tick-uri
+} task_t;
+
+typedef struct {
+    const char *name;
+    unsigned char (*run)(const int *argv, unsigned char argc, unsigned char text);
+    unsigned char min_args, max_args;
+    unsigned char reply;        // Linia pe care o poate pune handler-ul (CMD_REPLY_*)
+} cmd_t;
+
+// Tabela de taskuri - in flash, doar termenele si contoarele sunt in RAM
+// (cu sys_tick, RAM: 17 B)
+const task_t tasks[NUM_TASKS] = {
+    { Task_Tick,    MS_TO_TICKS(10)    },
+    { Task_Second,  MS_TO_TICKS(1000)  },
+    { Task_LCD,     MS_TO_TICKS(250)   },
+    { Task_Report,  MS_TO_TICKS(REPORT_PERIOD_MS) },  // Inlocuita de report_rate
+    { Task_Stats,   MS_TO_TICKS(60000) }
+};
+unsigned int task_next[NUM_TASKS];      // Urmatorul termen (tick)
+unsigned char task_overrun[NUM_TASKS];  // De cate ori a ratat termenul (max. 255)
+
+// Tabela de comenzi UART (in flash). BAUD si SYNC raspund direct, daca e
+// loc, altfel sunt ocupate; CALP asteapta raspunsul CAL in curs, care
+// citeste aceeasi inregistrare.
+const cmd_t cmds[NUM_CMDS] = {
+    { "TIME",     Cmd_Time,      3, 7,                      CMD_REPLY_TSYNC },     // hh:mm:ss[.mmm][,zz/ll/aaaa]
+    { "DATE",     Cmd_Date,      3, 3,                      CMD_REPLY_NONE },      // zz/ll/aaaa
+    { "RATE",     Cmd_Rate,      1, 1,                      CMD_REPLY_NONE },      // Perioada raportului, secunde
+    { "MODE",     Cmd_Mode,      1, 1,                      CMD_REPLY_NONE },      // Ecranul LCD (DISP_*)
+    { "ALARM",    Cmd_Alarm,     1, 1,                      CMD_REPLY_NONE },      // Secunde, 0 = anuleaza
+    { "CAL",      Cmd_Cal,       1, 3,                      CMD_REPLY_CAL },       // canal[,offset,castig]
+    { "CALP",     Cmd_CalPoints, 1, 1 + 2 * CAL_MAX_POINTS, CMD_REPLY_CAL },
+    { "PING",     Cmd_Ping,      0, 0,                      CMD_REPLY_NONE },
+    { "FMT",      Cmd_Fmt,       0, CMD_TEXT,               CMD_REPLY_NONE },
+    { "RAW",      Cmd_Raw,       1, 1,                      CMD_REPLY_NONE },
+    { "BAUD",     Cmd_Baud,      0, CMD_TEXT,               CMD_REPLY_NONE },      // BAUD:ACK / BAUD:NAK
+    { "SYNC",     Cmd_Sync,      0, CMD_TEXT,               CMD_REPLY_NONE },      // Ecoul liniei
+    { "RXOK",     Cmd_RxOk,      0, 1,                      CMD_REPLY_LOG },       // LOG:<n> la revenirea legaturii
+    { "BACKFILL", Cmd_Backfill,  0, 0,                      CMD_REPLY_NONE },
+    { "BFACK",    Cmd_BfAck,     1, 1,                      CMD_REPLY_NONE },
+    { "STAT",     Cmd_Stat,      0, 0,                      CMD_REPLY_NONE }
+};
+
+// Raspunsul ultimei comenzi, trimis pe bucati cand e loc (Cmd_SendReply).
+// RAM: 6 B + 1 bit
+unsigned char cmd_reply = CMD_REPLY_NONE;   // Linia handler-ului
+int cmd_reply_arg = 0;                      // Canalul CAL / abaterea TSYNC (ms)
+__bit cmd_ack;                              // Urmeaza ACK/NACK (linia avea #secventa)
+unsigned char cmd_ack_err = CMD_OK;
+unsigned int cmd_ack_seq = 0;
+
+// Starea aplicatiei, impartita intre taskuri (luxul se calculeaza din
+// light la afisare, Light_Lux). RAM: 13 B + 4 biti
+unsigned char disp_mode = DISP_WELCOME;
+__bit alarm_active, buzzer_on;
+unsigned int alarm_sec = 0;
+int temp1 = 0, humid1 = 0, light = 0, temp2 = 0, humid2 = 0; // Zecimi (C / %)
+__bit err_temp, err_humid;                  // Ultima masurare SHT21 a esuat
+
+// Starea filtrelor pentru T1, H1, L (filt_len[] e doar pentru FILT_AVG;
+// suma e filt_len[] * iesirea, |iesirea| <= CAL_OUT_MAX). Cu report_raw si
+// report_rate, RAM: 14 B + 1 bit
+const unsigned char filt_type[ADC_NUM_CH] = { FILT_AVG, FILT_AVG, FILT_MEDIAN };
+const unsigned char filt_len[ADC_NUM_CH]  = { 4, 4, 0 };
+int filt_state[ADC_NUM_CH][FILT_STATE];
+unsigned char filt_cnt = 0;                     // Esantioane vazute (max. 2)
+__bit report_raw;                               // REPORT_RAW_DEFAULT, din main
+unsigned char report_rate = REPORT_PERIOD_MS / 1000;    // Secunde intre rapoarte
+
+// Miscarea fiecarui canal de la ultima valoare trimisa si banda moarta,
+// in zecimi. Un octet pe canal: dincolo de banda moarta conteaza doar ca
+// s-a miscat, deci suma se satureaza la REPORT_MOVE_MAX si ramane acolo
+// pana la trimitere (o miscare inapoi nu o mai aduce sub banda). RAM: 10 B
+const int rep_deadband[REPORT_NUM_FIELDS] = { 2, 5, 10, 2, 5 };
+const char * const rep_names[REPORT_NUM_FIELDS] = { "T1:", "H1:", "L:", "T2:", "H2:" };
+const unsigned char rep_precision[REPORT_NUM_FIELDS] = { 1, 0, 0, 1, 0 };
+signed char rep_move[REPORT_NUM_FIELDS];
+unsigned char rep_valid = 0;                // 0 = raport complet la urmatoarea rulare
+unsigned char rep_text = 0;                 // Canalele raportului text in curs (pe bucati)
+unsigned char rep_full_tick = 0;           // Ultimul raport complet (TICKS64)
+unsigned char rep_partial = 0, rep_skipped = 0; // Rapoarte partiale / omise, de la ultimul STAT
+
+// Starea masurarii SHT21 si timpii reali de conversie (ms, sub
+// 85 + SHT21_TIMEOUT_MARGIN), T si RH. RAM: 17 B
+unsigned char sht_state = SHT21_IDLE;
+unsigned char sht_start_tick = 0;       // Inceputul conversiei (TICKS8)
+unsigned int sht_raw_temp = 0;
+unsigned char sht_conv_last[2] = {0, 0}, sht_conv_max[2] = {0, 0};
+unsigned char sht_retry = 0;            // Remasurari in ciclul curent
+unsigned char sht_crc_fail[2] = {0, 0}; // Cadre cu CRC invalid (T, RH, max. 255)
+unsigned char sht_retries[2] = {0, 0};  // Remasurari efectuate (T, RH, max. 255)
+unsigned char sht_res_level = SHT21_RES_LEVELS - 1;  // Dupa reset: T14/RH12
+unsigned char sht_res_target = SHT21_RES_LEVELS - 1; // Ales de manager
+unsigned char sht_stable_cycles = SHT21_NO_READING;
+unsigned char sht_sample_res = 14;      // Biti T ai ultimei masuratori
+
+// Scrierea EEPROM in curs (un octet la ~5ms, fara blocare), comuna
+// jurnalului si calibrarii, si octetii ei. RAM: 19 B; calibrarea nu tine
+// nimic in RAM (Cal_Apply).
+unsigned char ee_wr_pos = EE_WR_IDLE, ee_wr_len = 0, ee_wr_addr = 0;
+unsigned char ee_stage[EE_STAGE_SIZE];
+
+// Jurnalul EEPROM: blocul deschis si starea retransmisiei (BF:/BFACK:,
+// cate un bloc pe rand). Blocul deschis e cel dinaintea lui log_head;
+// cadrul cheie si epoca se citesc din antetul lui, iar locul
+// urmatorului esantion din date (Log_Scan). RAM: 8 B + 4 biti
+unsigned char log_head = 0, log_seq = 0;    // Urmatorul slot / seq de scris
+__bit log_blk_open;                         // Blocul dinaintea lui log_head primeste esantioane
+unsigned char log_dropped = 0;              // Esantioane neconfirmate suprascrise (max. 255)
+__bit link_up;                              // ESP32 a confirmat recent (RXOK)
+unsigned char link_rx_tick = 0;            // Ultimul RXOK (TICKS64)
+__bit log_bf_active, log_bf_acked;
+unsigned char log_bf_slot = LOG_NONE, log_bf_tries = 0, log_bf_ofs = 0;
+unsigned char log_bf_tick = 0;             // Ultima trimitere (TICKS8)
+
+// Formatul raportului si numarul de secventa al cadrelor binare.
+// RAM: 1 B + 1 bit
+__bit report_binary;                        // REPORT_BINARY_DEFAULT, din main
+unsigned char report_seq = 0;
+
+// Tabele pe nivel de rezolutie: bitii din registru, timpul maxim de
+// conversie (ms) si numarul de biti ai temperaturii (raportat)
+const unsigned char sht21_res_bits[SHT21_RES_LEVELS]   = { 0x01, 0x80, 0x00 };
+const unsigned char sht21_res_t_ms[SHT21_RES_LEVELS]   = { 22, 43, 85 };
+const unsigned char sht21_res_rh_ms[SHT21_RES_LEVELS]  = { 4, 9, 29 };
+const unsigned char sht21_res_t_bits[SHT21_RES_LEVELS] = { 12, 13, 14 };
 
 void setupPins() {
     TRISC0 = 0;    // RS ca output
     TRISC1 = 0;    // EN ca output
+#if LCD_USE_BUSY_FLAG
+    TRISC2 = 0;    // LCD RW ca output
+#else
     TRISC2 = 1;    // nefolosit
+#endif
     TRISC3 = 0;    // SHT21 SCL ca output
     TRISC4 = 1;    // SHT21 SDA ca input initial
     TRISD = 0x0F;  // nibble-ul superior ca output
@@ -114,6 +813,10 @@ void setupPins() {
     TRISB1 = 1;    // Buton timp 
     TRISB2 = 1;    // Buton senzori analogici
     TRISB3 = 1;    // Buton LDR
+    IOCB = 0x0F;   // Intrerupere la schimbare pe RB0..RB3
+    (void)PORTB;
+    INTCONbits.RBIF = 0;
+    INTCONbits.RBIE = 1;
     
     PORTA &= ~(1 << 3);  // Buzzer oprit initial
     
@@ -121,25 +824,71 @@ void setupPins() {
     PORTD = 0;     // Sterge portul D
 }
 
-void LCD_Command(unsigned char cmd) {
-    RS = 0;                    // Mod comanda
-    PORTD &= 0x0F;            // Sterge nibble-ul superior
-    PORTD |= (cmd & 0xF0);    // Trimite nibble-ul superior
-    
-    EN = 1;                   // Impuls Enable
-    __delay_us(5);
-    EN = 0;
-    __delay_us(5);
-    
+// Trimite un nibble (bitii 7..4) pe RD4-RD7
+void LCD_Nibble(unsigned char nibble) {
     PORTD &= 0x0F;            // Sterge nibble-ul superior
-    PORTD |= ((cmd << 4) & 0xF0); // Trimite nibble-ul inferior
+    PORTD |= (nibble & 0xF0);
     
-    EN = 1;                   // Impuls Enable
-    __delay_us(5);
+    EN = 1;                   // Impuls Enable (min. 450ns)
+    __delay_us(1);
     EN = 0;
-    __delay_us(5);
+    __delay_us(1);
+}
+
+// Aduna asteptarea (zeci de us) pentru STAT; se opreste la 0xFFFF
+void LCD_AddWait(unsigned int tens) {
+    lcd_wait = lcd_wait > 0xFFFFU - tens ? 0xFFFFU : lcd_wait + tens;
+}
+
+#if LCD_USE_BUSY_FLAG
+// Asteapta pana cand controllerul termina instructiunea anterioara
+void LCD_WaitBusy(void) {
+    unsigned char busy, polls = 0;
     
-    __delay_ms(2);            // Asteapta executia comenzii
+    TRISD |= 0xF0;            // RD4-RD7 ca intrari
+    RS = 0;
+    RW = 1;
+    do {
+        EN = 1;
+        __delay_us(1);
+        busy = PORTDbits.RD7; // D7 = BUSY (nibble-ul superior)
+        EN = 0;
+        __delay_us(1);
+        EN = 1;               // Nibble-ul inferior (contorul de adresa) ignorat
+        __delay_us(1);
+        EN = 0;
+        polls++;
+    } while (busy && polls < LCD_POLL_MAX);
+    RW = 0;
+    TRISD &= 0x0F;            // RD4-RD7 inapoi ca iesiri
+    
+    LCD_AddWait(polls * (LCD_POLL_US / 10));
+}
+#endif
+
+// Scrie un octet (rs = 0 comanda, 1 date) si asteapta doar cat e necesar
+void LCD_Write(unsigned char value, unsigned char rs) {
+#if LCD_USE_BUSY_FLAG
+    LCD_WaitBusy();
+#endif
+    RS = rs;
+    LCD_Nibble(value);        // Nibble-ul superior
+    LCD_Nibble((unsigned char)(value << 4)); // Nibble-ul inferior
+    lcd_writes++;
+    
+#if !LCD_USE_BUSY_FLAG
+    if (!rs && value <= 0x03) {
+        __delay_us(LCD_HOME_US);    // Clear / home
+        LCD_AddWait(LCD_HOME_US / 10);
+    } else {
+        __delay_us(LCD_EXEC_US);
+        LCD_AddWait(LCD_EXEC_US / 10);
+    }
+#endif
+}
+
+void LCD_Command(unsigned char cmd) {
+    LCD_Write(cmd, 0);        // Mod comanda
 }
 
 void LCD_Init() {
@@ -181,38 +930,21 @@ void LCD_Init() {
 }
 
 void LCD_Char(unsigned char data) {
-    RS = 1;                    // Mod date
-    PORTD &= 0x0F;            // Sterge nibble-ul superior
-    PORTD |= (data & 0xF0);   // Trimite nibble-ul superior
-    
-    EN = 1;
-    __delay_us(5);
-    EN = 0;
-    __delay_us(5);
-    
-    PORTD &= 0x0F;
-    PORTD |= ((data << 4) & 0xF0);
-    
-    EN = 1;
-    __delay_us(5);
-    EN = 0;
-    __delay_us(5);
-    
-    __delay_ms(2);
+    LCD_Write(data, 1);       // Mod date
 }
 
 void LCD_String(const char *str) {
     while(*str) LCD_Char(*str++);
 }
 
-unsigned int readADC(unsigned char channel) {
-    ADCON0 &= 0b11000011;       // Sterge bitii de selectie canal
-    ADCON0 |= (channel << 2);   // Selecteaza canalul dorit
-    __delay_us(20);             // Timp de achizitie
-    
-    ADCON0bits.GO = 1;          // Porneste conversia
-    while(ADCON0bits.GO);       // Asteapta conversia
-    return (unsigned int)((ADRESH << 8) + ADRESL);   // Returneaza rezultatul
+// Ultimul rezultat decimat pentru un canal (ADC_EXTRA_BITS biti in plus).
+// Nu asteapta niciodata conversia - citeste doar valoarea publicata de ISR.
+unsigned int ADC_Get(unsigned char channel) {
+    unsigned int value;
+    PIE1bits.ADIE = 0;          // Citire atomica pe 16 biti
+    value = adc_result[channel];
+    PIE1bits.ADIE = 1;
+    return value;
 }
 
 void setupADC() {
@@ -221,35 +953,166 @@ void setupADC() {
     ANSELH = 0x00;              // Fara pini analogici suplimentari
     
     ADCON1 = 0x80;              // Aliniere dreapta, Vref este VDD
-    ADCON0 = 0x01;              // Porneste ADC, selecteaza canalul 0
+    ADCON0 = 0x41;              // Fosc/8 (TAD = 2us), porneste ADC, canalul 0
     __delay_us(100);            // Asteapta stabilizarea ADC
+    
+    // Conversiile sunt pornite din tick-ul Timer1, rezultatul vine pe ADIF
+    PIR1bits.ADIF = 0;
+    PIE1bits.ADIE = 1;
+    INTCONbits.PEIE = 1;
+}
+
+// Sterge panoul si aduce framebuffer-ul in aceeasi stare (spatii)
+void LCDFB_Init(void) {
+    LCD_Command(0x01);
+    for (unsigned char i = 0; i < LCD_CELLS; i++) lcd_fb[i] = ' ';
+    lcd_pos = 0;
+}
+
+void LCDFB_Goto(unsigned char row, unsigned char col) {
+    lcd_pos = (unsigned char)(row * LCD_COLS + col);
+}
+
+// Scrie in framebuffer; marcheaza celula doar daca se schimba
+void LCDFB_Char(unsigned char c) {
+    if (lcd_pos >= LCD_CELLS) return;
+    if ((unsigned char)(lcd_fb[lcd_pos] & ~LCD_DIRTY) != c) lcd_fb[lcd_pos] = (char)(c | LCD_DIRTY);
+    // Nu trece pe randul urmator
+    if ((lcd_pos % LCD_COLS) != LCD_COLS - 1U) lcd_pos++;
+    else lcd_pos = LCD_CELLS;
+}
+
+void LCDFB_String(const char *str) {
+    while(*str) LCDFB_Char(*str++);
+}
+
+// Completeaza restul randului curent cu spatii
+void LCDFB_ClearEOL(void) {
+    while (lcd_pos < LCD_CELLS) {
+        unsigned char end_of_row = ((lcd_pos % LCD_COLS) == LCD_COLS - 1U);
+        LCDFB_Char(' ');
+        if (end_of_row) break;
+    }
+}
+
+// Trimite la panou doar celulele modificate. Adresa DDRAM se seteaza doar
+// la inceputul fiecarei secvente de celule consecutive.
+void LCDFB_Flush(void) {
+    unsigned char next_addr = 0xFF;     // Adresa curenta a cursorului LCD
+    
+    for (unsigned char i = 0; i < LCD_CELLS; i++) {
+        if (!(lcd_fb[i] & LCD_DIRTY)) continue;
+        lcd_fb[i] &= ~LCD_DIRTY;
+        
+        unsigned char addr = (i < LCD_COLS) ? i : (unsigned char)(0x40 + i - LCD_COLS);
+        if (addr != next_addr) LCD_Command((unsigned char)(0x80 | addr));
+        LCD_Char((unsigned char)lcd_fb[i]);
+        next_addr = addr + 1U;
+    }
 }
 
 void LCD_WriteInt(int value) {
     unsigned int uval = (unsigned int)value;
     if (uval >= 100U) {
-        LCD_Char((unsigned char)('0' + (uval / 100U)));
+        LCDFB_Char((unsigned char)('0' + (uval / 100U)));
         uval %= 100U;
     }
     if (uval >= 10U) {
-        LCD_Char((unsigned char)('0' + (uval / 10U)));
+        LCDFB_Char((unsigned char)('0' + (uval / 10U)));
         uval %= 10U;
     }
-    LCD_Char((unsigned char)('0' + uval));
+    LCDFB_Char((unsigned char)('0' + uval));
 }
 
-void LCD_WriteTemp(float temp) {
-    unsigned int integer = (unsigned int)temp;
-    unsigned int decimal = (unsigned int)((temp - (float)integer) * 10.0f);
+void LCD_WriteUInt(unsigned int value) {
+    unsigned int div = 10000U;
     
-    LCD_WriteInt(integer);
-    LCD_Char('.');
-    LCD_Char((unsigned char)('0' + decimal));
-    LCD_Char(' ');
-    LCD_Char('C');
+    while (div > 1U && value < div) div /= 10U;
+    for (; div; div /= 10U) {
+        LCDFB_Char((unsigned char)('0' + value / div));
+        value %= div;
+    }
+}
+
+// Temperatura in zecimi de grad
+void LCD_WriteTemp(int temp) {
+    if (temp < 0) {
+        LCDFB_Char('-');
+        temp = -temp;
+    }
+    unsigned int integer = (unsigned int)temp / 10U;
+    unsigned int decimal = (unsigned int)temp % 10U;
+    
+    LCD_WriteInt((int)integer);
+    LCDFB_Char('.');
+    LCDFB_Char((unsigned char)('0' + decimal));
+    LCDFB_Char(' ');
+    LCDFB_Char('C');
 }
 
-// Functii I2C simple
+#if I2C_USE_MSSP
+// Functii I2C cu modulul MSSP - aceeasi interfata ca varianta software.
+// Start/Restart/Stop/Read intorc 1 daca operatia s-a terminat, 0 la
+// coliziune sau timeout; Write intoarce 0 si in cazul asta (ca la NACK).
+
+// Asteapta sfarsitul operatiei: 0 la timeout sau la coliziune (BCLIF)
+unsigned char I2C_Wait(void) {
+    unsigned int timeout = I2C_WAIT_MAX;
+    while (!PIR1bits.SSPIF && !PIR2bits.BCLIF && --timeout);
+    PIR1bits.SSPIF = 0;
+    if (PIR2bits.BCLIF) {
+        PIR2bits.BCLIF = 0;     // MSSP a renuntat la magistrala, e din nou liber
+        return 0;
+    }
+    return timeout != 0;
+}
+
+void I2C_Init(void) {
+    SHT_SCL_DIR = 1; // MSSP controleaza pinii (open-drain)
+    SHT_SDA_DIR = 1;
+    SSPADD = I2C_SSPADD;
+    SSPSTAT = (I2C_SPEED_KHZ > 100) ? 0x00 : 0x80; // Slew rate doar la 400kHz
+    SSPCON = 0x28;   // SSPEN, master I2C, Fosc / (4 * (SSPADD + 1))
+    SSPCON2 = 0x00;
+    PIR1bits.SSPIF = 0;
+    PIR2bits.BCLIF = 0;
+    __delay_ms(1);   // Lasa liniile sa se stabilizeze
+}
+
+unsigned char I2C_Start(void) {
+    SSPCON2bits.SEN = 1;
+    return I2C_Wait();
+}
+
+// Start repetat (RSEN), fara STOP intre scriere si citire
+unsigned char I2C_Restart(void) {
+    SSPCON2bits.RSEN = 1;
+    return I2C_Wait();
+}
+
+unsigned char I2C_Stop(void) {
+    SSPCON2bits.PEN = 1;
+    return I2C_Wait();
+}
+
+unsigned char I2C_Write(unsigned char data) {
+    SSPBUF = data;
+    if (!I2C_Wait()) return 0;
+    return (SSPCON2bits.ACKSTAT == 0); // Returneaza 1 daca ACK primit
+}
+
+unsigned char I2C_Read(unsigned char send_ack, unsigned char *data) {
+    SSPCON2bits.RCEN = 1;
+    if (!I2C_Wait()) return 0;
+    *data = SSPBUF;
+    
+    SSPCON2bits.ACKDT = send_ack ? 0 : 1; // ACK sau NACK
+    SSPCON2bits.ACKEN = 1;
+    return I2C_Wait();
+}
+#else
+// Functii I2C simple. Magistrala e comandata direct, deci Start/Restart/
+// Stop/Read nu pot esua (intorc mereu 1).
 #define I2C_DELAY() __delay_us(5) // Delay pentru timing I2C
 
 void I2C_Init(void) {
@@ -260,7 +1123,7 @@ void I2C_Init(void) {
     __delay_ms(1);   // Lasa liniile sa se stabilizeze
 }
 
-void I2C_Start(void) {
+unsigned char I2C_Start(void) {
     SHT_SDA_DIR = 0; // SDA ca output
     SHT_SDA_PIN = 1; // SDA high
     I2C_DELAY();
@@ -270,9 +1133,16 @@ void I2C_Start(void) {
     I2C_DELAY();
     SHT_SCL_PIN = 0; // SCL low
     I2C_DELAY();
+    return 1;
+}
+
+// Start repetat: dupa un octet SCL e jos, iar I2C_Start ridica SDA inainte
+// de SCL, deci secventa e aceeasi
+unsigned char I2C_Restart(void) {
+    return I2C_Start();
 }
 
-void I2C_Stop(void) {
+unsigned char I2C_Stop(void) {
     SHT_SDA_DIR = 0; // SDA ca output
     SHT_SCL_PIN = 0; // SCL low
     I2C_DELAY();
@@ -283,6 +1153,7 @@ void I2C_Stop(void) {
     SHT_SDA_PIN = 1; // SDA high in timp ce SCL e high
     I2C_DELAY();
     SHT_SDA_DIR = 1; // Elibereaza SDA
+    return 1;
 }
 
 unsigned char I2C_Write(unsigned char data) {
@@ -318,18 +1189,18 @@ unsigned char I2C_Write(unsigned char data) {
     return (ack == 0); // Returneaza 1 daca ACK primit
 }
 
-unsigned char I2C_Read(unsigned char send_ack) {
+unsigned char I2C_Read(unsigned char send_ack, unsigned char *data) {
     unsigned char i;
-    unsigned char data = 0;
+    unsigned char byte = 0;
 
     SHT_SDA_DIR = 1; // SDA ca input
 
     for (i = 0; i < 8; i++) {
-        data <<= 1;
+        byte <<= 1;
         SHT_SCL_PIN = 1; // Clock high
         I2C_DELAY();
         if (SHT_SDA_PIN) {
-            data |= 0x01;
+            byte |= 0x01;
         }
         SHT_SCL_PIN = 0; // Clock low
         I2C_DELAY();
@@ -349,29 +1220,84 @@ unsigned char I2C_Read(unsigned char send_ack) {
     I2C_DELAY();
     SHT_SDA_DIR = 1; // Elibereaza SDA
     
-    return data;
+    *data = byte;
+    return 1;
 }
+#endif
 
 // Functii pentru SHT21
 void SHT21_Init(void) {
     I2C_Init(); // Initializeaza pinii I2C
     
     // Reset software
-    I2C_Start();
-    if (I2C_Write(SHT21_ADDRESS_WRITE)) {
+    if (I2C_Start() && I2C_Write(SHT21_ADDRESS_WRITE)) {
         I2C_Write(SHT21_CMD_SOFT_RESET);
     }
     I2C_Stop();
     __delay_ms(15); // Asteapta reset-ul
 }
 
-unsigned char SHT21_Measure(unsigned char sht_measure_cmd, unsigned int *value) {
-    unsigned char msb, lsb, crc_byte;
-    unsigned char error = 0;
-    unsigned char retry_count = 0;
+#if SHT21_CRC_NIBBLE
+const unsigned char sht21_crc_table[16] = {
+    0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97,
+    0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E
+};
+
+unsigned char SHT21_CRC8(unsigned char msb, unsigned char lsb) {
+    unsigned char crc = msb;
+    crc = (unsigned char)(crc << 4) ^ sht21_crc_table[crc >> 4];
+    crc = (unsigned char)(crc << 4) ^ sht21_crc_table[crc >> 4];
+    crc ^= lsb;
+    crc = (unsigned char)(crc << 4) ^ sht21_crc_table[crc >> 4];
+    crc = (unsigned char)(crc << 4) ^ sht21_crc_table[crc >> 4];
+    return crc;
+}
+#else
+const unsigned char sht21_crc_table[256] = {
+    0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97,
+    0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E,
+    0x43, 0x72, 0x21, 0x10, 0x87, 0xB6, 0xE5, 0xD4,
+    0xFA, 0xCB, 0x98, 0xA9, 0x3E, 0x0F, 0x5C, 0x6D,
+    0x86, 0xB7, 0xE4, 0xD5, 0x42, 0x73, 0x20, 0x11,
+    0x3F, 0x0E, 0x5D, 0x6C, 0xFB, 0xCA, 0x99, 0xA8,
+    0xC5, 0xF4, 0xA7, 0x96, 0x01, 0x30, 0x63, 0x52,
+    0x7C, 0x4D, 0x1E, 0x2F, 0xB8, 0x89, 0xDA, 0xEB,
+    0x3D, 0x0C, 0x5F, 0x6E, 0xF9, 0xC8, 0x9B, 0xAA,
+    0x84, 0xB5, 0xE6, 0xD7, 0x40, 0x71, 0x22, 0x13,
+    0x7E, 0x4F, 0x1C, 0x2D, 0xBA, 0x8B, 0xD8, 0xE9,
+    0xC7, 0xF6, 0xA5, 0x94, 0x03, 0x32, 0x61, 0x50,
+    0xBB, 0x8A, 0xD9, 0xE8, 0x7F, 0x4E, 0x1D, 0x2C,
+    0x02, 0x33, 0x60, 0x51, 0xC6, 0xF7, 0xA4, 0x95,
+    0xF8, 0xC9, 0x9A, 0xAB, 0x3C, 0x0D, 0x5E, 0x6F,
+    0x41, 0x70, 0x23, 0x12, 0x85, 0xB4, 0xE7, 0xD6,
+    0x7A, 0x4B, 0x18, 0x29, 0xBE, 0x8F, 0xDC, 0xED,
+    0xC3, 0xF2, 0xA1, 0x90, 0x07, 0x36, 0x65, 0x54,
+    0x39, 0x08, 0x5B, 0x6A, 0xFD, 0xCC, 0x9F, 0xAE,
+    0x80, 0xB1, 0xE2, 0xD3, 0x44, 0x75, 0x26, 0x17,
+    0xFC, 0xCD, 0x9E, 0xAF, 0x38, 0x09, 0x5A, 0x6B,
+    0x45, 0x74, 0x27, 0x16, 0x81, 0xB0, 0xE3, 0xD2,
+    0xBF, 0x8E, 0xDD, 0xEC, 0x7B, 0x4A, 0x19, 0x28,
+    0x06, 0x37, 0x64, 0x55, 0xC2, 0xF3, 0xA0, 0x91,
+    0x47, 0x76, 0x25, 0x14, 0x83, 0xB2, 0xE1, 0xD0,
+    0xFE, 0xCF, 0x9C, 0xAD, 0x3A, 0x0B, 0x58, 0x69,
+    0x04, 0x35, 0x66, 0x57, 0xC0, 0xF1, 0xA2, 0x93,
+    0xBD, 0x8C, 0xDF, 0xEE, 0x79, 0x48, 0x1B, 0x2A,
+    0xC1, 0xF0, 0xA3, 0x92, 0x05, 0x34, 0x67, 0x56,
+    0x78, 0x49, 0x1A, 0x2B, 0xBC, 0x8D, 0xDE, 0xEF,
+    0x82, 0xB3, 0xE0, 0xD1, 0x46, 0x77, 0x24, 0x15,
+    0x3B, 0x0A, 0x59, 0x68, 0xFF, 0xCE, 0x9D, 0xAC
+};
+
+unsigned char SHT21_CRC8(unsigned char msb, unsigned char lsb) {
+    return sht21_crc_table[sht21_crc_table[msb] ^ lsb];
+}
+#endif
 
-    // Trimite comanda de masurare
-    I2C_Start();
+// Trimite comanda de masurare si revine imediat.
+// Coduri de eroare: 1 = fara ACK la adresa, 2 = fara ACK la comanda,
+// SHT21_BUS_ERROR
+unsigned char SHT21_StartMeasure(unsigned char sht_measure_cmd) {
+    if (!I2C_Start()) return SHT21_BUS_ERROR;
     if (!I2C_Write(SHT21_ADDRESS_WRITE)) {
         I2C_Stop();
         return 1; // Nu s-a primit ACK de la SHT21
@@ -381,175 +1307,583 @@ unsigned char SHT21_Measure(unsigned char sht_measure_cmd, unsigned int *value)
         I2C_Stop();
         return 2; // Nu s-a primit ACK pentru comanda
     }
-    I2C_Stop();
+    return I2C_Stop() ? 0 : SHT21_BUS_ERROR;
+}
 
-    // Asteapta finalizarea masuratorii
-    if (sht_measure_cmd == SHT21_CMD_MEASURE_TEMP_NO_HOLD) {
-        __delay_ms(100);
-    } else if (sht_measure_cmd == SHT21_CMD_MEASURE_HUMID_NO_HOLD) {
-        __delay_ms(50);
-    } else {
-        __delay_ms(75);
+// O singura incercare de citire: SHT21_BUSY cat timp senzorul da NACK,
+// SHT21_CRC_ERROR daca datele nu corespund CRC-ului, SHT21_BUS_ERROR
+unsigned char SHT21_ReadResult(unsigned int *value) {
+    unsigned char msb, lsb, crc_byte;
+    
+    if (!I2C_Start()) return SHT21_BUS_ERROR;
+    if (!I2C_Write(SHT21_ADDRESS_READ)) {
+        I2C_Stop();
+        return SHT21_BUSY;
+    }
+    
+    if (!I2C_Read(1, &msb) ||       // MSB, trimite ACK
+        !I2C_Read(1, &lsb) ||       // LSB, trimite ACK
+        !I2C_Read(0, &crc_byte)) {  // CRC, trimite NACK
+        I2C_Stop();
+        return SHT21_BUS_ERROR;
     }
+    I2C_Stop();
+    
+    if (SHT21_CRC8(msb, lsb) != crc_byte) return SHT21_CRC_ERROR;
+    
+    *value = (unsigned int)(msb << 8) | lsb;
+    *value &= ~0x0003U; // Masca bitii de status
+    return 0; // Success
+}
 
-    // Incearca sa citeasca datele cu reincercari
-    for (retry_count = 0; retry_count < 3; retry_count++) {
-        I2C_Start();
-        if (I2C_Write(SHT21_ADDRESS_READ)) {
-            msb = I2C_Read(1);      // Citeste MSB, trimite ACK
-            lsb = I2C_Read(1);      // Citeste LSB, trimite ACK  
-            crc_byte = I2C_Read(0); // Citeste CRC, trimite NACK
-            
-            *value = (unsigned int)(msb << 8) | lsb;
-            *value &= ~0x0003U; // Masca bitii de status
-            
-            I2C_Stop();
-            return 0; // Success
-        }
+// Schimba rezolutia prin citire-modificare-scriere a registrului utilizator
+// (bitii rezervati, heater-ul si OTP raman neatinsi); citirea foloseste un
+// start repetat. 1 = citirea a esuat, 2 = scrierea a esuat
+unsigned char SHT21_SetResolution(unsigned char level) {
+    unsigned char reg;
+    
+    if (!I2C_Start() || !I2C_Write(SHT21_ADDRESS_WRITE) || !I2C_Write(SHT21_CMD_READ_USER_REG) ||
+        !I2C_Restart() || !I2C_Write(SHT21_ADDRESS_READ) || !I2C_Read(0, &reg)) {
+        I2C_Stop();
+        return 1;
+    }
+    I2C_Stop();
+    
+    reg = (unsigned char)((reg & ~SHT21_RES_MASK) | sht21_res_bits[level]);
+    
+    if (!I2C_Start() || !I2C_Write(SHT21_ADDRESS_WRITE) || !I2C_Write(SHT21_CMD_WRITE_USER_REG) ||
+        !I2C_Write(reg)) {
         I2C_Stop();
-        __delay_ms(10); // Asteapta inainte de reincercare
+        return 2;
+    }
+    if (!I2C_Stop()) return 2;
+    
+    sht_res_level = level;
+    return 0;
+}
+
+// Alege rezolutia pentru ciclul urmator dupa cat de repede variaza valorile.
+// Prima citire doar porneste comparatia (temp2/humid2 sunt inca 0).
+void SHT21_AdaptResolution(int new_temp, int new_humid) {
+    int dt = new_temp - temp2, drh = new_humid - humid2;
+    
+    if (sht_stable_cycles == SHT21_NO_READING) {
+        sht_stable_cycles = 0;
+        return;
+    }
+    if (dt < 0) dt = -dt;
+    if (drh < 0) drh = -drh;
+    
+    if (dt >= SHT21_FAST_DELTA_T || drh >= SHT21_FAST_DELTA_RH) {
+        sht_res_target = 0;
+        sht_stable_cycles = 0;
+    } else if (++sht_stable_cycles >= SHT21_STABLE_CYCLES) {
+        sht_stable_cycles = 0;
+        if (sht_res_target < SHT21_RES_LEVELS - 1) sht_res_target++;
+    }
+}
+
+// Porneste un ciclu temperatura + umiditate (daca nu e deja unul in curs)
+void SHT21_BeginCycle(void) {
+    if (sht_state != SHT21_IDLE) return;
+    
+    // Rezolutia se schimba doar intre cicluri
+    if (sht_res_target != sht_res_level) SHT21_SetResolution(sht_res_target);
+    
+    err_temp = (SHT21_StartMeasure(SHT21_CMD_MEASURE_TEMP_NO_HOLD) != 0);
+    if (err_temp) {
+        err_humid = err_temp;
+        return;
     }
+    sht_start_tick = TICKS8();
+    sht_retry = 0;
+    sht_state = SHT21_WAIT_TEMP;
+}
 
-    return 3; // Esuat dupa reincercari
+// Interogheaza senzorul la fiecare tick si avanseaza masina de stari
+void Task_SHT21(void) {
+    unsigned int raw, elapsed_ms, max_ms;
+    unsigned char idx, err;
+    int new_temp;
+    
+    if (sht_state == SHT21_IDLE) return;
+    
+    idx = (sht_state == SHT21_WAIT_TEMP) ? 0 : 1;
+    max_ms = idx ? sht21_res_rh_ms[sht_res_level] : sht21_res_t_ms[sht_res_level];
+    elapsed_ms = TICKS8_SINCE(sht_start_tick) * TICK_MS;
+    
+    // Nu incarca magistrala inainte de timpul tipic (~3/4 din maxim)
+    if (elapsed_ms < (max_ms * 3U) / 4U) return;
+    
+    err = SHT21_ReadResult(&raw);
+    
+    if (err == SHT21_BUSY) {
+        if (elapsed_ms < max_ms + SHT21_TIMEOUT_MARGIN) return;
+        err = 3; // Senzorul nu a terminat in timp util
+    } else if (err == SHT21_CRC_ERROR) {
+        if (sht_crc_fail[idx] < 0xFF) sht_crc_fail[idx]++;
+        // Datele nu pot fi recitite - se repeta masurarea, in limita bugetului
+        if (sht_retry < SHT21_MAX_RETRIES) {
+            sht_retry++;
+            if (sht_retries[idx] < 0xFF) sht_retries[idx]++;
+            err = SHT21_StartMeasure(idx ? SHT21_CMD_MEASURE_HUMID_NO_HOLD
+                                         : SHT21_CMD_MEASURE_TEMP_NO_HOLD);
+            if (!err) {
+                sht_start_tick = TICKS8();
+                return;
+            }
+        }
+    } else if (!err) {
+        sht_conv_last[idx] = (unsigned char)elapsed_ms;
+        if (sht_conv_last[idx] > sht_conv_max[idx]) sht_conv_max[idx] = sht_conv_last[idx];
+    }
+    
+    if (sht_state == SHT21_WAIT_TEMP) {
+        err_temp = (err != 0);
+        if (err) {
+            err_humid = 1;
+            sht_state = SHT21_IDLE;
+            return;
+        }
+        sht_raw_temp = raw;
+        sht_retry = 0;
+        err_humid = (SHT21_StartMeasure(SHT21_CMD_MEASURE_HUMID_NO_HOLD) != 0);
+        if (err_humid) {
+            temp2 = Report_Track(REPORT_T2, temp2, SHT21_CalcTemperature(sht_raw_temp));
+            sht_state = SHT21_IDLE;
+            return;
+        }
+        sht_start_tick = TICKS8();
+        sht_state = SHT21_WAIT_HUMID;
+    } else {
+        err_humid = (err != 0);
+        new_temp = SHT21_CalcTemperature(sht_raw_temp);
+        if (!err) {
+            int new_humid = SHT21_CalcHumidity(raw);
+            SHT21_AdaptResolution(new_temp, new_humid);
+            humid2 = Report_Track(REPORT_H2, humid2, new_humid);
+        }
+        temp2 = Report_Track(REPORT_T2, temp2, new_temp);
+        sht_sample_res = sht21_res_t_bits[sht_res_level];
+        sht_state = SHT21_IDLE;
+    }
 }
 
-float SHT21_CalcTemperature(unsigned int rawValue) {
+// Cost estimat (cicluri, 1us/ciclu la 4MHz), float XC8 vs virgula fixa.
+// Sunt estimari din costul tipic al rutinelor float/long de biblioteca,
+// nu masuratori (nici in simulator):
+//   SHT21_CalcTemperature  ~1850 vs ~450    SHT21_CalcHumidity ~2050 vs ~420
+//   getLM35Temperature     ~2200 vs ~400    getHIH5030Humidity ~4000 vs ~450
+//   getLDRValue            ~1850 vs ~400    LCD_WriteTemp      ~1150 vs ~250
+// getHIH5030Humidity e socotita fara compensarea de temperatura; cu ea
+// (impartirea float, respectiv hih_rh_lut[]) estimarea e ~5500 vs ~650.
+
+#if USE_FLOAT_MATH
+int SHT21_CalcTemperature(unsigned int rawValue) {
     // Formula: T_C = -46.85 + 175.72 * (S_T / 2^16)
-    return -46.85f + 175.72f * (float)rawValue / 65536.0f;
+    float t = -46.85f + 175.72f * (float)rawValue / 65536.0f;
+    return (int)(t * 10.0f + (t < 0.0f ? -0.5f : 0.5f));
 }
 
-float SHT21_CalcHumidity(unsigned int rawValue) {
+int SHT21_CalcHumidity(unsigned int rawValue) {
     // Formula: RH_true = -6.0 + 125.0 * (S_RH / 2^16)
     float rh = -6.0f + 125.0f * (float)rawValue / 65536.0f;
     
     if(rh > 100.0f) rh = 100.0f;
     if(rh < 0.0f) rh = 0.0f;
     
-    return rh;
+    return (int)(rh * 10.0f + 0.5f);
 }
 
-float getLM35Temperature(void) {
-    unsigned int adc_value = readADC(LM35_CHANNEL);
-    float voltage = (adc_value * 5.0) / 1024.0;
-    return voltage * 100.0;
+int getLM35Temperature(void) {
+    unsigned int adc_value = ADC_Get(LM35_CHANNEL);
+    float voltage = (adc_value * 5.0f) / ADC_FULL_SCALE;
+    return (int)(voltage * 1000.0f + 0.5f);
 }
 
-float getHIH5030Humidity(void) {
-    unsigned int adc_value = readADC(HIH_CHANNEL);
-    float voltage = (adc_value * 5.0) / 1024.0;
-    float humid = (voltage / 5.0 - 0.1515) / 0.00636;
+int getHIH5030Humidity(int temp) {
+    unsigned int adc_value = ADC_Get(HIH_CHANNEL);
+    float voltage = (adc_value * 5.0f) / ADC_FULL_SCALE;
+    float humid = (voltage / 5.0f - 0.1515f) / 0.00636f;
+    
+    // Compensarea din foaia de catalog (temp in zecimi de grad)
+    humid /= 1.0546f - 0.00216f * (float)temp / 10.0f;
     
     if(humid > 100.0f) humid = 100.0f;
     if(humid < 0.0f) humid = 0.0f;
     
-    return humid;
+    return (int)(humid * 10.0f + 0.5f);
 }
 
-float getLDRValue(void) {
-    unsigned int adc_value = readADC(LDR_CHANNEL);
+int getLDRValue(void) {
+    unsigned int adc_value = ADC_Get(LDR_CHANNEL);
     
-    // Previne impartirea la zero
-    if (adc_value == 0) adc_value = 1;
-    if (adc_value > 1023) adc_value = 1023;
+    if (adc_value > ADC_FULL_SCALE - 1) adc_value = ADC_FULL_SCALE - 1;
     
-    // Converteste valoarea ADC in procente
     // LDR: valoare ADC mica = mai multa lumina
-    float light_percent = 100.0f - ((float)adc_value / 1023.0f) * 100.0f;
+    float light_percent = 100.0f - ((float)adc_value / (float)(ADC_FULL_SCALE - 1)) * 100.0f;
     
-    return light_percent;
+    return (int)(light_percent * 10.0f + 0.5f);
+}
+#else
+int SHT21_CalcTemperature(unsigned int rawValue) {
+    // T[0.1C] = S_T * 1757.2 / 2^16 - 468.5
+    return (int)(((unsigned long)rawValue * SHT21_T_GAIN) >> 18) - SHT21_T_OFFSET;
 }
 
-// Functie pentru verificare butoane
-unsigned char isButtonPressed(unsigned char pin) {
-    static unsigned char prev[5] = {1,1,1,1,1}; // RA4, RB0, RB1, RB2, RB3
-    unsigned char current, result = 0;
-    unsigned char idx;
+int SHT21_CalcHumidity(unsigned int rawValue) {
+    // RH[0.1%] = S_RH * 1250 / 2^16 - 60
+    int rh = (int)((((unsigned long)rawValue * SHT21_RH_GAIN) + (1UL << 14)) >> 15) - SHT21_RH_OFFSET;
     
-    switch(pin) {
-        case 4: current = BUTTON_PIN; idx = 0; break;          // RA4
-        case 0: current = PORTBbits.RB0; idx = 1; break;       // RB0
-        case 1: current = PORTBbits.RB1; idx = 2; break;       // RB1
-        case 2: current = PORTBbits.RB2; idx = 3; break;       // RB2
-        case 3: current = PORTBbits.RB3; idx = 4; break;       // RB3
-        default: return 0;
-    }
+    if(rh > 1000) rh = 1000;
+    if(rh < 0) rh = 0;
     
-    if (prev[idx] == 1 && current == 0) {
-        result = 1;
-        __delay_ms(20);
-    }
-    prev[idx] = current;
-    return result;
+    return rh;
 }
 
-unsigned char isAlarmButtonPressed(void) {
-    static unsigned char previous = 1;
-    unsigned char current = BUTTON_PIN;
-    unsigned char result = 0;
+int getLM35Temperature(void) {
+    unsigned int adc_value = ADC_Get(LM35_CHANNEL);
+    // 10mV/C => T[0.1C] = tensiunea in mV
+    return (int)((((unsigned long)adc_value * LM35_MV_FS) + (1UL << (ADC_SCALE_SHIFT - 1))) >> ADC_SCALE_SHIFT);
+}
+
+// Iesire ratiometrica, compensata: interpolare biliniara in hih_rh_lut[]
+// dupa codul ADC si temperatura (zecimi de grad, limitata la tabel)
+int getHIH5030Humidity(int temp) {
+    unsigned int adc_value = ADC_Get(HIH_CHANNEL);
+    unsigned char col = (unsigned char)(adc_value >> HIH_LUT_CSHIFT), row;
+    unsigned int fc = adc_value & ((1U << HIH_LUT_CSHIFT) - 1);
+    const int *lo, *hi;
+    long a, b;
+    int humid;
+    
+    if (temp < HIH_LUT_T0) temp = HIH_LUT_T0;
+    if (temp > HIH_LUT_TMAX) temp = HIH_LUT_TMAX;
+    temp -= HIH_LUT_T0;
+    row = (unsigned char)((unsigned int)temp >> HIH_LUT_TSHIFT);
+    lo = &hih_rh_lut[row][col];
+    hi = &hih_rh_lut[row + 1][col];
+    
+    a = lo[0] + (((long)(lo[1] - lo[0]) * fc + (1L << (HIH_LUT_CSHIFT - 1))) >> HIH_LUT_CSHIFT);
+    b = hi[0] + (((long)(hi[1] - hi[0]) * fc + (1L << (HIH_LUT_CSHIFT - 1))) >> HIH_LUT_CSHIFT);
+    a += ((b - a) * (temp & ((1 << HIH_LUT_TSHIFT) - 1)) + (1L << (HIH_LUT_TSHIFT - 1))) >> HIH_LUT_TSHIFT;
+    humid = (int)((a + 5) / 10);        // 0.01% -> zecimi
+    
+    if(humid > 1000) humid = 1000;
+    if(humid < 0) humid = 0;
     
-    if (previous == 1 && current == 0) {
-        result = 1;
-        __delay_ms(20);  // debounce
-    }
+    return humid;
+}
+
+int getLDRValue(void) {
+    unsigned int adc_value = ADC_Get(LDR_CHANNEL);
     
-    previous = current;
-    return result;
+    // LDR: valoare ADC mica = mai multa lumina
+    return (int)LDR_PERMILLE_FS - (int)(((unsigned long)adc_value * LDR_PERMILLE_FS) >> ADC_SCALE_SHIFT);
 }
+#endif
 
-unsigned char isAnalogButtonPressed(void) {
-    static unsigned char previous = 1;
-    unsigned char current = PORTBbits.RB2;
-    unsigned char result = 0;
+// log2(x) in Q8, x >= 1
+int Lux_Log2(unsigned int x) {
+    unsigned char e = 15, i;
+    unsigned int f;
     
-    if (previous == 1 && current == 0) {
-        result = 1;
-        __delay_ms(20);  // debounce
+    while (!(x & 0x8000U)) {
+        x <<= 1;
+        e--;
     }
+    i = (unsigned char)((x >> 11) & 0x0F);
+    f = x & 0x07FF;
+    return ((int)e << 8) + (int)lux_log2[i] + (int)(((unsigned long)(lux_log2[i + 1] - lux_log2[i]) * f + 0x400) >> 11);
+}
+
+// Nivelul de lumina (zecimi de %, filtrat si calibrat) in lux; eroare
+// sub 1 lx sau 3% fata de formula, in afara plafonului
+unsigned int Light_Lux(int light) {
+    int d = 1000 - light, y;
+    unsigned char e, i, f;
+    unsigned long m;
+    
+    if (d <= 0) return LUX_MAX;
+    if (d >= 1000) return 0;
+    
+    y = LUX_LOG2_K - (int)(((long)(Lux_Log2((unsigned int)d) - Lux_Log2((unsigned int)(1000 - d))) * LUX_INV_GAMMA + 128) >> 8);
+    if (y < -256) return 0;                 // Sub 0.5 lx
+    if (y >= (16 << 8)) return LUX_MAX;
+    
+    // 2^y = 2^(parte intreaga) * lux_exp2[] interpolat
+    e = (unsigned char)((y + 256) >> 8);    // Exponent + 1, fara deplasari negative
+    f = (unsigned char)y;
+    i = f >> 4;
+    m = lux_exp2[i] + (((unsigned long)(lux_exp2[i + 1] - lux_exp2[i]) * (f & 0x0F) + 8) >> 4);
+    m = ((m << e) + (1UL << 14)) >> 15;
+    return m > LUX_MAX ? LUX_MAX : (unsigned int)m;
+}
+
+// Intreg little-endian din EEPROM
+int EE_ReadInt(unsigned char addr) {
+    return (int)(EE_Read(addr) | ((unsigned int)EE_Read(addr + 1) << 8));
+}
+
+// Numarul de puncte al unei inregistrari valide (0 daca e corupt)
+unsigned char Cal_Points(unsigned char base) {
+    unsigned char n = EE_Read(base + CAL_OFS_NPTS);
     
-    previous = current;
-    return result;
+    return n > CAL_MAX_POINTS ? 0 : n;
+}
+
+// Corectia pe segmente din cele n puncte de la addr
+int Cal_Correction(unsigned char addr, unsigned char n, int value) {
+    int x0, x1 = 0;
+    signed char d0, d1 = 0;
+    
+    for (unsigned char i = 0; i < n; i++, addr += 3) {
+        x0 = x1;
+        d0 = d1;
+        x1 = EE_ReadInt(addr);
+        d1 = (signed char)EE_Read(addr + 2);
+        if (value > x1) continue;
+        if (i == 0 || x1 == x0) return d1;
+        return d0 + (int)((long)(d1 - d0) * (value - x0) / (x1 - x0));
+    }
+    return d1;
+}
+
+// Costul obisnuit: o inmultire 16x16 (sarita la castig 1.0) si o adunare.
+// Rezultatul se limiteaza la +/-CAL_OUT_MAX, ca suma filtrului sa incapa
+// in int; punctele se aplica valorii deja limitate.
+// Coeficientii nu se tin in RAM: se citesc din EEPROM la fiecare esantion,
+// cateva cicluri pe octet, pentru ca Task_Sample nu ruleaza cat timp
+// EEPROM-ul se scrie (EE_Read ar astepta ~5ms pe octet).
+int Cal_Apply(unsigned char ch, int value) {
+    unsigned char base = EE_CAL_BASE + ch * CAL_REC_SIZE, n;
+    int gain;
+    long v = value;
+    
+    if (EE_Read(base) != CAL_VALID) return value;
+    gain = EE_ReadInt(base + CAL_OFS_GAIN);
+    if (gain != CAL_GAIN_ONE) v = ((long)value * gain + CAL_GAIN_ONE / 2) >> 12;
+    v += EE_ReadInt(base + CAL_OFS_OFFSET);
+    if (v > CAL_OUT_MAX) v = CAL_OUT_MAX;
+    if (v < -CAL_OUT_MAX) v = -CAL_OUT_MAX;
+    value = (int)v;
+    n = Cal_Points(base);
+    if (n) {
+        value += Cal_Correction(base + CAL_OFS_PTS, n, value);
+        if (value > CAL_OUT_MAX) value = CAL_OUT_MAX;
+        if (value < -CAL_OUT_MAX) value = -CAL_OUT_MAX;
+    }
+    return value;
+}
+
+// Inregistrarea curenta a canalului pregatita pentru EE_Write, in ordinea
+// din EEPROM (marcajul se scrie ultimul, dupa ce locul lui a fost sters);
+// un canal necalibrat porneste de la offset 0, castig 1.0 si niciun punct,
+// iar un castig in afara limitelor (scris de un firmware mai vechi) revine
+// la 1.0
+void Cal_Stage(unsigned char ch) {
+    unsigned char base = EE_CAL_BASE + ch * CAL_REC_SIZE;
+    int gain = EE_ReadInt(base + CAL_OFS_GAIN);
+    
+    for (unsigned char n = 0; n < CAL_REC_USED; n++) ee_stage[n] = EE_Read(base + n);
+    if (ee_stage[0] != CAL_VALID) {
+        ee_stage[CAL_OFS_OFFSET] = 0;
+        ee_stage[CAL_OFS_OFFSET + 1] = 0;
+        ee_stage[CAL_OFS_NPTS] = 0;
+        gain = 0;
+    }
+    if (gain < CAL_GAIN_MIN || gain > CAL_GAIN_MAX) {
+        ee_stage[CAL_OFS_GAIN] = (unsigned char)CAL_GAIN_ONE;
+        ee_stage[CAL_OFS_GAIN + 1] = (unsigned char)(CAL_GAIN_ONE >> 8);
+    }
+    ee_stage[0] = CAL_VALID;
 }
 
-unsigned char isDigitalButtonPressed(void) {
-    static unsigned char previous = 1;
-    unsigned char current = PORTBbits.RB0;
-    unsigned char result = 0;
+// CAL:<canal> raspunde CAL:<canal>,<offset>,<castig>[,<x>,<corectie>...];
+// CAL:<canal>,<offset>,<castig Q12, CAL_GAIN_MIN..CAL_GAIN_MAX> le schimba.
+// Ocupat cat timp EEPROM-ul se scrie, ca punctele citite sa fie cele scrise.
+unsigned char Cmd_Cal(const int *argv, unsigned char argc, unsigned char text) {
+    unsigned char ch = (unsigned char)argv[0];
+    (void)text;
+    
+    if (argv[0] < 0 || argv[0] >= CAL_CHANNELS || argc == 2) return CMD_ERR_ARGS;
+    if (argc == 3 && (argv[1] < -CAL_MAX_VALUE || argv[1] > CAL_MAX_VALUE || argv[2] < CAL_GAIN_MIN || argv[2] > CAL_GAIN_MAX)) return CMD_ERR_ARGS;
+    if (ee_wr_pos != EE_WR_IDLE) return CMD_ERR_BUSY;
+    if (argc == 1) {
+        cmd_reply_arg = ch;
+        cmd_reply = CMD_REPLY_CAL;
+        return CMD_OK;
+    }
     
-    if (previous == 1 && current == 0) {
-        result = 1;
-        __delay_ms(20);  // debounce
+    Cal_Stage(ch);
+    ee_stage[CAL_OFS_OFFSET] = (unsigned char)argv[1];
+    ee_stage[CAL_OFS_OFFSET + 1] = (unsigned char)((unsigned int)argv[1] >> 8);
+    ee_stage[CAL_OFS_GAIN] = (unsigned char)argv[2];
+    ee_stage[CAL_OFS_GAIN + 1] = (unsigned char)((unsigned int)argv[2] >> 8);
+    EE_Write(EE_CAL_BASE + ch * CAL_REC_SIZE, CAL_REC_USED, 1);
+    return CMD_OK;
+}
+
+// CALP:<canal>[,<x>,<corectie>...]: puncte noi (x crescator), fara
+// puncte le sterge. Pastreaza offsetul si castigul (Cal_Stage il aduce in
+// limite).
+unsigned char Cmd_CalPoints(const int *argv, unsigned char argc, unsigned char text) {
+    unsigned char ch = (unsigned char)argv[0], n;
+    (void)text;
+    
+    if (argv[0] < 0 || argv[0] >= CAL_CHANNELS || !(argc & 1)) return CMD_ERR_ARGS;
+    for (n = 1; n < argc; n += 2) {
+        if (argv[n] < -CAL_MAX_VALUE || argv[n] > CAL_MAX_VALUE) return CMD_ERR_ARGS;
+        if (argv[n + 1] < -128 || argv[n + 1] > 127 || (n > 1 && argv[n] <= argv[n - 2])) return CMD_ERR_ARGS;
     }
+    if (ee_wr_pos != EE_WR_IDLE) return CMD_ERR_BUSY;
     
-    previous = current;
-    return result;
+    Cal_Stage(ch);
+    for (n = 0; n < argc / 2; n++) {
+        ee_stage[CAL_OFS_PTS + 3 * n] = (unsigned char)argv[1 + 2 * n];
+        ee_stage[CAL_OFS_PTS + 3 * n + 1] = (unsigned char)((unsigned int)argv[1 + 2 * n] >> 8);
+        ee_stage[CAL_OFS_PTS + 3 * n + 2] = (unsigned char)argv[2 + 2 * n];
+    }
+    ee_stage[CAL_OFS_NPTS] = n;
+    EE_Write(EE_CAL_BASE + ch * CAL_REC_SIZE, CAL_REC_USED, 1);
+    return CMD_OK;
+}
+
+// Raspunsul CAL pentru canalul din cmd_reply_arg, pe bucati (Cmd_ReplyPart):
+// antetul, cate un punct, sfarsitul liniei; 0 dupa ultima bucata. Se
+// citeste din EEPROM, care nu se schimba cat timp raspunsul e in asteptare.
+unsigned char Cal_ReplyPart(unsigned char part) {
+    unsigned char base = EE_CAL_BASE + (unsigned char)cmd_reply_arg * CAL_REC_SIZE, addr;
+    unsigned char valid = (EE_Read(base) == CAL_VALID), n = valid ? Cal_Points(base) : 0;
+    
+    if (part == 0) {
+        UART_SendString("CAL:");
+        UART_SendUInt((unsigned int)cmd_reply_arg);
+        UART_SendByte(',');
+        UART_SendInt(valid ? EE_ReadInt(base + CAL_OFS_OFFSET) : 0);
+        UART_SendByte(',');
+        UART_SendInt(valid ? EE_ReadInt(base + CAL_OFS_GAIN) : CAL_GAIN_ONE);
+    } else if (part <= n) {
+        addr = base + CAL_OFS_PTS + 3 * (part - 1);
+        UART_SendByte(',');
+        UART_SendInt(EE_ReadInt(addr));
+        UART_SendByte(',');
+        UART_SendInt((signed char)EE_Read(addr + 2));
+    } else if (part == n + 1) {
+        UART_SendString("\r\n");
+    } else {
+        return 0;
+    }
+    return 1;
 }
 
-unsigned char isLDRButtonPressed(void) {
-    static unsigned char previous = 1;
-    unsigned char current = PORTBbits.RB3;
-    unsigned char result = 0;
+// Adauga esantionul brut la filtrul canalului si intoarce valoarea
+// filtrata. La pornire se folosesc esantioanele existente.
+int Filter_Update(unsigned char ch, int raw) {
+    int *st = filt_state[ch];
+    int len = filt_len[ch], a = st[0], b = st[1];
+    
+    if (filt_type[ch] == FILT_AVG) {
+        // st[0] = len * iesirea; esantionul nou inlocuieste 1/len din ea
+        if (!filt_cnt) a = raw * len;
+        else a += raw - (a + (a < 0 ? -len / 2 : len / 2)) / len;
+        st[0] = a;
+        st[1] = raw;
+        return (a + (a < 0 ? -len / 2 : len / 2)) / len;
+    }
     
-    if (previous == 1 && current == 0) {
-        result = 1;
-        __delay_ms(20);  // debounce
+    st[1] = raw;
+    if (filt_type[ch] == FILT_MEDIAN) {
+        // st[0], st[1] = penultimul si ultimul esantion brut
+        st[0] = b;
+        if (filt_cnt == 0) return raw;
+        if (filt_cnt == 1) return (raw < b) ? raw : b;     // Din doua, cel mic
+        if (a > b) {
+            int t = a;
+            a = b;
+            b = t;
+        }
+        if (raw < a) return a;
+        if (raw > b) return b;
+        return raw;
     }
+    return raw;
+}
+
+// Dupa ce toate canalele au primit esantionul curent
+void Filter_Advance(void) {
+    if (filt_cnt < 2) filt_cnt++;
+}
+
+// Ultimul esantion brut (nefiltrat) al canalului
+int Filter_Raw(unsigned char ch) {
+    return filt_state[ch][1];
+}
+
+// Pune un eveniment in coada (din ISR)
+void Buttons_Push(unsigned char ev) {
+    unsigned char next = (btn_q_head + 1U) & BTN_QUEUE_MASK;
     
-    previous = current;
-    return result;
+    if (next == btn_q_tail) {
+        if (btn_q_overflow < 0xFF) btn_q_overflow++;
+        return;
+    }
+    btn_queue[btn_q_head] = ev;
+    btn_q_head = next;
 }
 
-unsigned char isTimeButtonPressed(void) {
-    static unsigned char previous = 1;
-    unsigned char current = PORTBbits.RB1;
-    unsigned char result = 0;
+// Esantioneaza butoanele la fiecare tick (din ISR). Integratorul urca la
+// fiecare esantion apasat si coboara la fiecare esantion liber; starea se
+// schimba doar la capete, deci saltaturile contactului nu trec.
+void Buttons_Scan(void) {
+    unsigned char raw = (unsigned char)((~PORTB & 0x0F) | btn_edges);
     
-    if (previous == 1 && current == 0) {
-        result = 1;
-        __delay_ms(20);  // debounce
+    if (!BUTTON_PIN) raw |= 1U << BTN_ALARM;
+    btn_edges = 0;
+    
+    for (unsigned char i = 0; i < BTN_COUNT; i++) {
+        unsigned char mask = (unsigned char)(1U << i);
+        unsigned char n = (unsigned char)(((btn_integ_hi & mask) ? 2U : 0U) | ((btn_integ_lo & mask) ? 1U : 0U));
+        
+        if (raw & mask) {
+            if (n < BTN_DEBOUNCE) n++;
+        } else if (n) {
+            n--;
+        }
+        if (n & 2U) btn_integ_hi |= mask;
+        else btn_integ_hi &= (unsigned char)~mask;
+        if (n & 1U) btn_integ_lo |= mask;
+        else btn_integ_lo &= (unsigned char)~mask;
+        
+        if (!(btn_state & mask)) {
+            if (n == BTN_DEBOUNCE) {
+                btn_state |= mask;
+                btn_held = i;
+                btn_hold = 0;
+                Buttons_Push(BTN_EV_PRESS | i);
+            }
+        } else if (n == 0) {
+            btn_state &= (unsigned char)~mask;
+        } else if (i != btn_held) {
+            // Tinut, dar altul a fost apasat dupa el
+        } else if (++btn_hold == BTN_LONG_TICKS) {
+            Buttons_Push(BTN_EV_LONG | i);
+        } else if (btn_hold == BTN_LONG_TICKS + BTN_REPEAT_TICKS) {
+            btn_hold = BTN_LONG_TICKS;
+            Buttons_Push(BTN_EV_REPEAT | i);
+        }
     }
+    btn_busy = ((btn_integ_hi | btn_integ_lo) != 0);
+}
+
+// Urmatorul eveniment din coada, sau BTN_EV_NONE
+unsigned char Buttons_GetEvent(void) {
+    unsigned char ev;
     
-    previous = current;
-    return result;
+    if (btn_q_tail == btn_q_head) return BTN_EV_NONE;
+    ev = btn_queue[btn_q_tail];
+    btn_q_tail = (btn_q_tail + 1U) & BTN_QUEUE_MASK;
+    return ev;
 }
 
 void soundBuzzer(unsigned int duration_ms) {
@@ -563,24 +1897,26 @@ void soundBuzzer(unsigned int duration_ms) {
 }
 
 void displayAlarmCountdown(unsigned int seconds) {
-    LCD_Command(0x01);
-    LCD_Command(0x80);
-    LCD_String(alarm_txt);
+    LCDFB_Goto(0, 0);
+    LCDFB_String(alarm_txt);
     
     unsigned int mins = seconds / 60U, secs = seconds % 60U;
-    LCD_Char((unsigned char)('0' + (mins / 10U)));
-    LCD_Char((unsigned char)('0' + (mins % 10U)));
-    LCD_Char(':');
-    LCD_Char((unsigned char)('0' + (secs / 10U)));
-    LCD_Char((unsigned char)('0' + (secs % 10U)));
-    
-    LCD_Command(0xC0);
-    LCD_String(alarm_add);
+    LCDFB_Char((unsigned char)('0' + (mins / 10U)));
+    LCDFB_Char((unsigned char)('0' + (mins % 10U)));
+    LCDFB_Char(':');
+    LCDFB_Char((unsigned char)('0' + (secs / 10U)));
+    LCDFB_Char((unsigned char)('0' + (secs % 10U)));
+    LCDFB_ClearEOL();
+    
+    LCDFB_Goto(1, 0);
+    LCDFB_String(alarm_add);
+    LCDFB_ClearEOL();
 }
 
 // Bara de incarcare simplificata
 void displayLoadingBar(unsigned int duration_ms) {
     unsigned char progress = 0;
+    (void)duration_ms;
     LCD_Command(0x01);
     LCD_Command(0x80);
     LCD_String("Pornire...");
@@ -598,12 +1934,10 @@ void setupUART(void) {
     TRISC6 = 0;  // TX ca output
     TRISC7 = 1;  // RX ca input
     
-    SPBRG = 25;  // 9600 baud la 4MHz
-    SPBRGH = 0;
-    
-    TXSTA = 0x24; // Porneste transmiterul
+    TXSTA = 0x24; // Porneste transmiterul, BRGH = 1
     RCSTA = 0x90; // Porneste receptorul si portul serial
-    BAUDCTL = 0x00;
+    BAUDCTL = 0x08; // BRG16 = 1
+    UART_SetBaud(UART_BAUD_DEFAULT);
     
     // Porneste intreruperea pentru receptie UART
     PIE1bits.RCIE = 1;
@@ -612,9 +1946,113 @@ void setupUART(void) {
     __delay_ms(100);
 }
 
+// Schimba rata UART. Apelantul se asigura ca transmisia s-a terminat;
+// linia receptionata partial e abandonata.
+void UART_SetBaud(unsigned char idx) {
+    RCSTAbits.CREN = 0;
+    SPBRGH = 0;
+    SPBRG = uart_baud_brg[idx];
+    uart_baud = idx;
+    if (UART_RX_PARTIAL()) uart_rx_bad = 1;
+    uart_rx_errors = 0;
+    uart_err_window = TICKS8();
+    RCSTAbits.CREN = 1;
+}
+
+// BAUD:<rata> de la ESP32 - confirma daca rata e in tabel
+void UART_RequestBaud(unsigned char arg) {
+    unsigned long rate = 0;
+    
+    for (; uart_rx_buf[arg] >= '0' && uart_rx_buf[arg] <= '9'; arg = UART_RX_NEXT(arg)) {
+        rate = rate * 10 + (unsigned char)(uart_rx_buf[arg] - '0');
+    }
+    
+    for (unsigned char i = 0; i < UART_NUM_BAUDS; i++) {
+        if (rate == uart_baud_div10[i] * 10UL) {
+            UART_SendString("BAUD:ACK\r\n");
+            UART_Commit();
+            uart_baud_next = i;
+            uart_baud_state = UART_BAUD_PENDING; // Task_Link schimba rata
+            return;
+        }
+    }
+    UART_SendString("BAUD:NAK\r\n");
+    UART_Commit();
+}
+
+// Revine la 9600 (fara BAUD:OK sau prea multe erori de receptie)
+void UART_Fallback(void) {
+    UART_SetBaud(UART_BAUD_DEFAULT);
+    uart_baud_state = UART_BAUD_FIXED;
+    if (uart_fallbacks < 0xFF) uart_fallbacks++;
+    if (UART_Reserve(15)) {                 // Informativ: nu se asteapta loc
+        UART_SendString("BAUD:FALLBACK\r\n");
+        UART_Commit();
+    }
+}
+
+// Adauga un octet la linia in curs si revine imediat
 void UART_SendByte(unsigned char data) {
-    while (!TXIF);
-    TXREG = data;
+    unsigned char next = (uart_tx_wr + 1U) & UART_TX_MASK;
+    
+    if (next == uart_tx_tail) {
+        uart_tx_drop = 1;
+        return;
+    }
+    uart_tx_buf[uart_tx_wr] = data;
+    uart_tx_wr = next;
+}
+
+// Preda ISR-ului linia in curs, sau o arunca intreaga daca vreun octet
+// nu a incaput. Intoarce 0 pentru linia aruncata.
+unsigned char UART_Commit(void) {
+    unsigned char used;
+    
+    if (uart_tx_drop) {
+        uart_tx_drop = 0;
+        uart_tx_wr = uart_tx_head;
+        if (uart_tx_overflow < 0xFF) uart_tx_overflow++;
+        return 0;
+    }
+    uart_tx_head = uart_tx_wr;
+    PIE1bits.TXIE = 1;        // ISR-ul goleste coada
+    
+    used = (uart_tx_head - uart_tx_tail) & UART_TX_MASK;
+    if (used > uart_tx_hwm) uart_tx_hwm = used;
+    return 1;
+}
+
+// Spatiu liber in coada de transmisie
+unsigned char UART_TxFree(void) {
+    return (unsigned char)(UART_TX_MASK - ((uart_tx_wr - uart_tx_tail) & UART_TX_MASK));
+}
+
+// 1 daca o linie de cel mult len octeti scrisa acum incape intreaga (ISR-ul
+// doar elibereaza loc). Refuza cat timp o linie e trimisa pe bucati, ca
+// nimic sa nu intre in mijlocul ei.
+unsigned char UART_Reserve(unsigned char len) {
+    return uart_tx_owner == UART_OWNER_NONE && UART_TxFree() >= len;
+}
+
+// Trimite bucatile part(0), part(1), ... ale unei linii mai lungi decat
+// coada, cat timp e loc pentru cate UART_PART_MAX octeti; part() intoarce
+// 0 dupa ultima. Intoarce 1 cand linia a iesit toata; altfel coada ramane
+// a lui owner, iar urmatorul apel continua cu bucata urmatoare.
+unsigned char UART_SendParts(unsigned char owner, unsigned char (*part)(unsigned char)) {
+    unsigned char more;
+    
+    if (uart_tx_owner != owner && uart_tx_owner != UART_OWNER_NONE) return 0;
+    uart_tx_owner = UART_OWNER_NONE;
+    while (UART_Reserve(UART_PART_MAX)) {
+        more = part(uart_tx_part++);
+        UART_Commit();
+        if (!more) {
+            uart_tx_part = 0;
+            return 1;
+        }
+    }
+    if (uart_tx_part) uart_tx_owner = owner;
+    return 0;
 }
 
 void UART_SendString(const char *str) {
@@ -623,42 +2061,108 @@ void UART_SendString(const char *str) {
     }
 }
 
-void UART_SendFloat(float value, unsigned char precision) {
-    unsigned int int_part = (unsigned int)value;
+void UART_SendUInt(unsigned int value) {
+    unsigned int div = 10000U;
+    unsigned char started = 0;
+    
+    while (div > 1U) {
+        unsigned char digit = (unsigned char)(value / div);
+        if (digit || started) {
+            UART_SendByte((unsigned char)('0' + digit));
+            started = 1;
+        }
+        value %= div;
+        div /= 10U;
+    }
+    UART_SendByte((unsigned char)('0' + value));
+}
+
+// Trimite o valoare in zecimi: cu o zecimala sau rotunjita la intreg
+void UART_SendInt(int value) {
+    if (value < 0) {
+        UART_SendByte('-');
+        value = -value;
+    }
+    UART_SendUInt((unsigned int)value);
+}
+
+void UART_SendULong(unsigned long value) {
+    char digits[10];
+    unsigned char n = 0;
     
-    // Trimite partea intreaga
-    if (int_part >= 100U) UART_SendByte((unsigned char)('0' + (int_part / 100U)));
-    if (int_part >= 10U) UART_SendByte((unsigned char)('0' + ((int_part / 10U) % 10U)));
-    UART_SendByte((unsigned char)('0' + (int_part % 10U)));
+    do {
+        digits[n++] = (char)('0' + (unsigned char)(value % 10UL));
+        value /= 10UL;
+    } while (value);
+    while (n) UART_SendByte((unsigned char)digits[--n]);
+}
+
+void UART_SendFixed(int value, unsigned char precision) {
+    if (value < 0) {
+        UART_SendByte('-');
+        value = -value;
+    }
     
     if (precision > 0) {
+        UART_SendUInt((unsigned int)value / 10U);
         UART_SendByte('.');
-        unsigned int dec_part = (unsigned int)((value - (float)int_part) * 10.0f);
-        UART_SendByte((unsigned char)('0' + dec_part));
+        UART_SendByte((unsigned char)('0' + ((unsigned int)value % 10U)));
+    } else {
+        UART_SendUInt(((unsigned int)value + 5U) / 10U);
+    }
+}
+
+// Trimite un cadru codat COBS intre doi delimitatori 0x00
+void UART_SendCOBS(const unsigned char *buf, unsigned char len) {
+    unsigned char start = 0, run, i;
+    
+    UART_SendByte(0x00);
+    for (;;) {
+        // Lungimea secventei fara zero-uri (max. 254)
+        run = 0;
+        while ((unsigned char)(start + run) < len && buf[start + run] != 0 && run < 254U) run++;
+        
+        UART_SendByte((unsigned char)(run + 1U));
+        for (i = 0; i < run; i++) UART_SendByte(buf[start + i]);
+        
+        start += run;
+        if (start >= len) break;
+        if (run < 254U) start++;    // Zero-ul e implicit in codul blocului
+    }
+    UART_SendByte(0x00);
+}
+
+// CRC-16/CCITT, un octet (MSB primul)
+unsigned int CRC16_Update(unsigned int crc, unsigned char data) {
+    crc ^= (unsigned int)data << 8;
+    for (unsigned char i = 0; i < 8; i++) {
+        if (crc & 0x8000U) crc = (crc << 1) ^ CRC16_POLY;
+        else crc <<= 1;
     }
+    return crc;
 }
 
-void sendSensorDataToESP(float temp_lm35, float humid_hih, float light_ldr, 
-                        float temp_sht, float humid_sht, unsigned char error_status) {
+void sendSensorDataToESP(int temp_lm35, int humid_hih, int light_ldr, 
+                        int temp_sht, int humid_sht, unsigned char error_status) {
     UART_SendString("{");
     
     UART_SendString("\"lm35_temp\":");
-    UART_SendFloat(temp_lm35, 1);
+    UART_SendFixed(temp_lm35, 1);
     UART_SendString(",");
     
     UART_SendString("\"hih_humid\":");
-    UART_SendFloat(humid_hih, 0);
+    UART_SendFixed(humid_hih, 0);
     UART_SendString(",");
     
     UART_SendString("\"light\":");
-    UART_SendFloat(light_ldr, 0);
+    UART_SendFixed(light_ldr, 0);
     UART_SendString(",");
     
     UART_SendString("\"sht_temp\":");
     if (error_status & 0x01) {
         UART_SendString("\"error\"");
     } else {
-        UART_SendFloat(temp_sht, 1);
+        UART_SendFixed(temp_sht, 1);
     }
     UART_SendString(",");
     
@@ -666,85 +2170,806 @@ void sendSensorDataToESP(float temp_lm35, float humid_hih, float light_ldr,
     if (error_status & 0x02) {
         UART_SendString("\"error\"");
     } else {
-        UART_SendFloat(humid_sht, 0);
+        UART_SendFixed(humid_sht, 0);
     }
     
     UART_SendString("}\r\n");
+    UART_Commit();
 }
 
-void incrementTime(void) {
-    // Aceasta functie e doar backup cand ESP32 nu trimite timp
-    if (time_valid) return; // Nu incrementa daca avem timp valid de la ESP32
-    
-    unsigned int hh, mm, ss;
-    // Parseaza timpul curent din time_str
-    hh = (unsigned int)((time_str[0] - '0') * 10 + (time_str[1] - '0'));
-    mm = (unsigned int)((time_str[3] - '0') * 10 + (time_str[4] - '0'));
-    ss = (unsigned int)((time_str[6] - '0') * 10 + (time_str[7] - '0'));
+// Citeste un octet din EEPROM (asteapta o scriere in curs, max ~5ms)
+unsigned char EE_Read(unsigned char addr) {
+    while (EECON1bits.WR);
+    EEADR = addr;
+    EECON1bits.EEPGD = 0;
+    EECON1bits.RD = 1;
+    return EEDATA;
+}
 
-    ss++; // Incrementeaza secundele
+// Porneste scrierea unui octet; se termina singura (EECON1.WR = 0)
+void EE_StartWrite(unsigned char addr, unsigned char data) {
+    unsigned char gie = INTCONbits.GIE;
+    
+    EEADR = addr;
+    EEDATA = data;
+    EECON1bits.EEPGD = 0;
+    EECON1bits.WREN = 1;
+    INTCONbits.GIE = 0;         // Secventa de deblocare nu se intrerupe
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;
+    INTCONbits.GIE = gie;
+    EECON1bits.WREN = 0;
+}
 
-    if (ss >= 60U) {
-        ss = 0;
-        mm++;
-        if (mm >= 60U) {
-            mm = 0;
-            hh++;
-            if (hh >= 24U) {
-                hh = 0;
-            }
+// Reface capetele jurnalului: blocul cu cea mai noua secventa e ultimul
+// scris (cel mult LOG_SLOTS blocuri, deci comparatia circulara pe 8 biti
+// e sigura). Blocul deschis inainte de reset ramane inchis.
+void Log_Init(void) {
+    unsigned char newest = LOG_NONE, newest_seq = 0;
+    
+    for (unsigned char i = 0; i < LOG_SLOTS; i++) {
+        unsigned char base = EE_LOG_BASE + i * LOG_BLK_SIZE;
+        unsigned char seq = EE_Read(base + LOG_OFS_SEQ);
+        
+        if (EE_Read(base + LOG_OFS_FLAGS) == LOG_F_EMPTY) continue;
+        if (newest == LOG_NONE || (signed char)(seq - newest_seq) > 0) {
+            newest = i;
+            newest_seq = seq;
         }
     }
-
-    // Formeaza time_str manual
-    time_str[0] = (char)('0' + (hh / 10U));
-    time_str[1] = (char)('0' + (hh % 10U));
-    time_str[3] = (char)('0' + (mm / 10U));
-    time_str[4] = (char)('0' + (mm % 10U));
-    time_str[6] = (char)('0' + (ss / 10U));
-    time_str[7] = (char)('0' + (ss % 10U));
+    if (newest != LOG_NONE) {
+        log_head = (newest + 1U) % LOG_SLOTS;
+        log_seq = newest_seq + 1U;
+    }
 }
 
-unsigned char my_strlen(const char* str) {
-    unsigned char len = 0;
-    while (str[len++]);
-    return --len;
+// Programeaza o scriere in fundal: len octeti din ee_stage de la addr
+// (cei de dupa ee_stage se scriu 0xFF, ca dupa stergere), primul (flags, marcajul de calibrare, octetul cu sfarsitul sirului de
+// esantioane) ultimul, ca sa o valideze. Cu clear, locul lui se sterge
+// intai, ca o scriere intrerupta de reset sa nu para valida. Apelantul
+// verifica ee_wr_pos == EE_WR_IDLE.
+void EE_Write(unsigned char addr, unsigned char len, unsigned char clear) {
+    ee_wr_addr = addr;
+    ee_wr_len = len;
+    ee_wr_pos = (clear && EE_Read(addr) != 0xFF) ? 0 : 1;
 }
 
-char* my_strstr(const char* haystack, const char* needle) {
-    unsigned char nlen = my_strlen(needle), i, j;
-    if (nlen == 0) return (char*)haystack;
-    
-    for (i = 0; haystack[i]; i++) {
-        for (j = 0; j < nlen && haystack[i + j] == needle[j]; j++);
-        if (j == nlen) return (char*)&haystack[i];
+// Un octet pe rulare, din Task_Link
+void EE_Service(void) {
+    if (ee_wr_pos == EE_WR_IDLE || EECON1bits.WR) return;
+    if (ee_wr_pos == 0) {
+        EE_StartWrite(ee_wr_addr, 0xFF);
+        ee_wr_pos = 1;
+    } else if (ee_wr_pos < ee_wr_len) {
+        EE_StartWrite(ee_wr_addr + ee_wr_pos, ee_wr_pos < EE_STAGE_SIZE ? ee_stage[ee_wr_pos] : 0xFF);
+        ee_wr_pos++;
+    } else {
+        EE_StartWrite(ee_wr_addr, ee_stage[0]);
+        ee_wr_pos = EE_WR_IDLE;
     }
-    return 0;
 }
 
-// Parseaza timpul de la ESP32
-void parseESPTimeData(char* data) {
-    char* time_start = my_strstr(data, "TIME:");
-    if (time_start) {
-        time_start += 5;
-        for (unsigned char i = 0; i < 8; i++) time_str[i] = time_start[i];
-        time_str[8] = '\0';
-        time_valid = 1;
-    }
+// Adauga o cifra hexa (nibble) la sirul pregatit in st; jumatatea de jos
+// a unui octet nou ramane 0xF, ca dupa stergere
+void Log_PutNibble(unsigned char *st, unsigned char *pos, unsigned char nib) {
+    if (*pos & 1U) st[*pos >> 1] = (st[*pos >> 1] & 0xF0U) | nib;
+    else st[*pos >> 1] = (unsigned char)(nib << 4) | 0x0FU;
+    (*pos)++;
 }
 
-void processUARTData(void) {
-    if (!uart_data_ready) return;
-    uart_data_ready = 0;
+// Cifra hexa nib din sirul de esantioane al blocului de la base
+unsigned char Log_Nibble(unsigned char base, unsigned char nib) {
+    unsigned char b = EE_Read(base + LOG_OFS_DATA + (nib >> 1));
+    
+    return (nib & 1U) ? (b & 0x0FU) : (b >> 4);
+}
+
+// Esantioanele blocului de la base (cu cadrul cheie) si, in nibs, cifrele
+// hexa ocupate: sirul se termina la LOG_NIB_END sau la capatul blocului
+unsigned char Log_Scan(unsigned char base, unsigned char *nibs) {
+    unsigned char count = 1, nib = 0, i;
+    
+    *nibs = 0;
+    for (;;) {
+        for (i = 0; i < REPORT_NUM_FIELDS && nib < LOG_DATA_NIBS; i++) {
+            unsigned char n = Log_Nibble(base, nib);
+            
+            if (n == LOG_NIB_END) break;
+            nib += (n == LOG_NIB_ESC) ? 5U : 1U;
+        }
+        if (i < REPORT_NUM_FIELDS || nib > LOG_DATA_NIBS) return count;
+        *nibs = nib;
+        count++;
+    }
+}
+
+// Pasul la care cade epoch in blocul de la base (0 = cadrul cheie), sau
+// LOG_NONE daca e inaintea blocului ori prea departe de el
+unsigned char Log_StepOf(unsigned char base, unsigned long epoch) {
+    for (unsigned char k = 0; k < 4; k++) epoch -= (unsigned long)EE_Read(base + LOG_OFS_EPOCH + k) << (8 * k);
+    if (epoch >= (unsigned long)LOG_NONE * LOG_STEP_S) return LOG_NONE;
+    return (unsigned char)((unsigned int)epoch / LOG_STEP_S);
+}
+
+// Salveaza esantionul pasului curent de LOG_STEP_S. Task_Second il cere
+// in fiecare secunda cat lipseste ESP32; se scrie o singura data, in
+// primele LOG_LATE_S secunde ale pasului, deci o secunda repetata sau
+// intarziata nu il dubleaza si nu il pierde. Cat timp validitatea, ora
+// si spatiul o permit, esantionul se adauga la blocul deschis ca
+// diferente fata de cadrul cheie, 1 cifra hexa pe canal (-7..6) sau
+// LOG_NIB_ESC + valoarea intreaga pe 4 cifre, urmate de LOG_NIB_END.
+// Altfel se deschide un bloc nou cu un cadru cheie, peste cel mai vechi.
+// Scrierea se face din EE_Service, un octet pe rand.
+void Log_Append(void) {
+    rtc_t now;
+    unsigned long epoch;
+    unsigned char flags, base, nib = 0, pos, start, need = 0;
+    int d;                                  // Diferenta, valoarea sau contorul, pe rand
+    
+    log_bf_active = 0;                      // Legatura a cazut in timpul retransmisiei
+    log_bf_slot = LOG_NONE;
+    
+    (void)RTC_Get(&now);
+    start = now.sec % LOG_STEP_S;
+    if (start >= LOG_LATE_S || ee_wr_pos != EE_WR_IDLE) return;
+    epoch = RTC_ToEpoch(&now) - start;      // Inceputul pasului
+    flags = Report_Valid();
+    if (!time_valid) flags |= LOG_F_NOTIME;
+    
+    base = EE_LOG_BASE + (unsigned char)((log_head + LOG_SLOTS - 1U) % LOG_SLOTS) * LOG_BLK_SIZE;
+    if (log_blk_open) {
+        pos = Log_Scan(base, &nib);
+        start = Log_StepOf(base, epoch);
+        if (start == pos - 1U) return;      // Pasul e deja salvat
+        if (start == pos && EE_Read(base + LOG_OFS_FLAGS) == flags) {
+            for (unsigned char i = 0; i < REPORT_NUM_FIELDS; i++) {
+                d = Report_Value(i) - EE_ReadInt(base + LOG_OFS_KEY + 2U * i);
+                need += (d >= -LOG_NIB_BIAS && d < LOG_NIB_ESC - LOG_NIB_BIAS) ? 1U : 5U;
+            }
+        }
+    }
+    
+    if (need && nib + need <= LOG_DATA_NIBS) {
+        // Diferente si cifra de sfarsit; octetul inceput de esantionul
+        // precedent se rescrie ultimul, deci sfarsitul lui vechi ramane
+        // pana cand esantionul nou e scris complet
+        start = nib >> 1;
+        pos = nib & 1U;
+        ee_stage[0] = EE_Read(base + LOG_OFS_DATA + start);
+        for (unsigned char i = 0; i < REPORT_NUM_FIELDS; i++) {
+            d = Report_Value(i) - EE_ReadInt(base + LOG_OFS_KEY + 2U * i);
+            
+            if (d >= -LOG_NIB_BIAS && d < LOG_NIB_ESC - LOG_NIB_BIAS) {
+                Log_PutNibble(ee_stage, &pos, (unsigned char)(d + LOG_NIB_BIAS));
+            } else {
+                d = Report_Value(i);
+                Log_PutNibble(ee_stage, &pos, LOG_NIB_ESC);
+                for (signed char s = 12; s >= 0; s -= 4) Log_PutNibble(ee_stage, &pos, (unsigned char)((unsigned int)d >> s) & 0x0FU);
+            }
+        }
+        if (nib + need < LOG_DATA_NIBS) Log_PutNibble(ee_stage, &pos, LOG_NIB_END);
+        EE_Write(base + LOG_OFS_DATA + start, (unsigned char)((pos + 1U) >> 1), 0);
+    } else {
+        // Bloc nou; cel vechi din slot se pierde daca nu a fost confirmat
+        base = EE_LOG_BASE + log_head * LOG_BLK_SIZE;
+        start = EE_Read(base + LOG_OFS_FLAGS);
+        if (start != LOG_F_EMPTY && !(start & LOG_F_ACKED)) {
+            d = log_dropped + Log_Scan(base, &nib);
+            log_dropped = d > 0xFF ? 0xFF : (unsigned char)d;
+        }
+        
+        ee_stage[LOG_OFS_FLAGS] = flags;
+        ee_stage[LOG_OFS_SEQ] = log_seq++;
+        for (unsigned char i = 0; i < 4; i++) ee_stage[LOG_OFS_EPOCH + i] = (unsigned char)(epoch >> (8 * i));
+        pos = LOG_OFS_KEY;
+        for (unsigned char i = 0; i < REPORT_NUM_FIELDS; i++) {
+            d = Report_Value(i);
+            ee_stage[pos++] = (unsigned char)d;
+            ee_stage[pos++] = (unsigned char)((unsigned int)d >> 8);
+        }
+        
+        // Octetul de dupa antet iese 0xFF: sirul gol (LOG_NIB_END)
+        log_blk_open = 1;
+        log_head = (log_head + 1U) % LOG_SLOTS;
+        EE_Write(base, LOG_OFS_DATA + 1U, 1);
+    }
+}
+
+// Octetii ocupati dintr-un bloc (antet + sirul de esantioane)
+unsigned char Log_BlockLen(unsigned char base) {
+    unsigned char nib;
+    
+    (void)Log_Scan(base, &nib);
+    return LOG_OFS_DATA + ((nib + 1U) >> 1);
+}
+
+// Cel mai vechi bloc neconfirmat, sau LOG_NONE
+unsigned char Log_NextPending(void) {
+    for (unsigned char k = 0; k < LOG_SLOTS; k++) {
+        unsigned char slot = (log_head + k) % LOG_SLOTS;
+        unsigned char flags = EE_Read(EE_LOG_BASE + slot * LOG_BLK_SIZE + LOG_OFS_FLAGS);
+        
+        if (flags != LOG_F_EMPTY && !(flags & LOG_F_ACKED)) return slot;
+    }
+    return LOG_NONE;
+}
+
+// Esantioane neconfirmate
+unsigned int Log_Pending(void) {
+    unsigned int count = 0;
+    unsigned char nib;
     
-    if (my_strstr(uart_buffer, "TIME:")) parseESPTimeData(uart_buffer);
+    for (unsigned char slot = 0; slot < LOG_SLOTS; slot++) {
+        unsigned char base = EE_LOG_BASE + slot * LOG_BLK_SIZE;
+        unsigned char flags = EE_Read(base + LOG_OFS_FLAGS);
+        
+        if (flags != LOG_F_EMPTY && !(flags & LOG_F_ACKED)) count += Log_Scan(base, &nib);
+    }
+    return count;
+}
+
+// BF:<seq>,<lungime>,<pozitie>,<octeti hexa> - o bucata de bloc
+void Log_SendChunk(void) {
+    static const char hex[] = "0123456789ABCDEF";
+    unsigned char base = EE_LOG_BASE + log_bf_slot * LOG_BLK_SIZE;
+    unsigned char len = Log_BlockLen(base), end = log_bf_ofs + LOG_BF_CHUNK;
+    
+    if (end > len) end = len;
+    UART_SendString("BF:");
+    UART_SendUInt(EE_Read(base + LOG_OFS_SEQ));
+    UART_SendByte(',');
+    UART_SendUInt(len);
+    UART_SendByte(',');
+    UART_SendUInt(log_bf_ofs);
+    UART_SendByte(',');
+    for (; log_bf_ofs < end; log_bf_ofs++) {
+        unsigned char b = EE_Read(base + log_bf_ofs);
+        UART_SendByte((unsigned char)hex[b >> 4]);
+        UART_SendByte((unsigned char)hex[b & 0x0FU]);
+    }
+    UART_SendString("\r\n");
+    UART_Commit();
+}
+
+// Retransmisia stop-and-wait (bloc cu bloc), din Task_Link
+void Log_Service(void) {
+    if (ee_wr_pos != EE_WR_IDLE || !log_bf_active) return;
+    
+    // Confirmat: marcheaza blocul (doar octetul flags)
+    if (log_bf_acked) {
+        unsigned char addr = EE_LOG_BASE + log_bf_slot * LOG_BLK_SIZE + LOG_OFS_FLAGS;
+        
+        ee_stage[0] = EE_Read(addr) | LOG_F_ACKED;
+        EE_Write(addr, 1, 0);
+        log_bf_acked = 0;
+        log_bf_slot = LOG_NONE;
+        return;
+    }
+    
+    if (!UART_Reserve(LOG_BF_LINE_MAX)) return;
+    if (log_bf_slot == LOG_NONE) {
+        log_bf_slot = Log_NextPending();
+        log_bf_tries = 0;
+        if (log_bf_slot == LOG_NONE) {
+            UART_SendString("BF:END\r\n");
+            UART_Commit();
+            log_bf_active = 0;
+            return;
+        }
+        log_bf_ofs = 0;
+    } else if (log_bf_ofs >= Log_BlockLen(EE_LOG_BASE + log_bf_slot * LOG_BLK_SIZE)) {
+        // Blocul e trimis in intregime; se asteapta BFACK
+        if (TICKS8_SINCE(log_bf_tick) < MS_TO_TICKS(LOG_BF_TIMEOUT_MS)) return;
+        if (++log_bf_tries >= LOG_BF_TRIES) {
+            log_bf_active = 0;          // ESP32 nu mai raspunde
+            log_bf_slot = LOG_NONE;
+            return;
+        }
+        log_bf_ofs = 0;
+    }
+    
+    Log_SendChunk();
+    log_bf_tick = TICKS8();
+}
+
+// RXOK de la ESP32. La revenirea legaturii inchide blocul curent si
+// anunta jurnalul restant.
+void Link_Alive(void) {
+    link_rx_tick = TICKS64();
+    if (link_up) return;
+    link_up = 1;
+    log_blk_open = 0;
+    cmd_reply = CMD_REPLY_LOG;
+}
+
+// Avanseaza ceasul cu o secunda (din ISR). Cazul obisnuit se termina
+// dupa o singura comparatie.
+void RTC_Tick(void) {
+    unsigned char days;
+    
+    if (++rtc.sec < 60) return;
+    rtc.sec = 0;
+    if (++rtc.min < 60) return;
+    rtc.min = 0;
+    if (++rtc.hour < 24) return;
+    rtc.hour = 0;
+    
+    days = rtc_month_days[rtc.month - 1];
+    if (rtc.month == 2 && (rtc.year & 3) == 0) days = 29;
+    if (++rtc.day <= days) return;
+    rtc.day = 1;
+    if (++rtc.month <= 12) return;
+    rtc.month = 1;
+    if (++rtc.year > 99) rtc.year = 0;
+}
+
+// Copie consistenta a ceasului (fara tick Timer1 la mijloc); intoarce
+// tick-urile scurse din secunda curenta (LOW_POWER: dupa un somn pot
+// trece de 99 pana la tick-ul urmator)
+unsigned char RTC_Get(rtc_t *out) {
+    unsigned char ticks;
+    PIE1bits.TMR1IE = 0;
+    *out = rtc;
+    ticks = timer1_count;
+    PIE1bits.TMR1IE = 1;
+    return ticks;
+}
+
+// Seteaza ceasul, cu tick-urile deja scurse din secunda curenta
+void RTC_Set(const rtc_t *in, unsigned char ticks) {
+    PIE1bits.TMR1IE = 0;
+    rtc = *in;
+    timer1_count = ticks;
+    PIE1bits.TMR1IE = 1;
+}
+
+// Secunde de la 01/01/2000 00:00:00
+unsigned long RTC_ToEpoch(const rtc_t *t) {
+    unsigned int days = t->year * 365U + (t->year + 3U) / 4U;  // + ani bisecti trecuti
+    
+    for (unsigned char m = 1; m < t->month; m++) days += rtc_month_days[m - 1];
+    if (t->month > 2 && (t->year & 3) == 0) days++;
+    days += t->day - 1U;
+    
+    return ((unsigned long)days * 24UL + t->hour) * 3600UL + t->min * 60U + t->sec;
+}
+
+// Imparte corectia in numarari intregi si rest pentru ISR
+void Time_SetCorrection(int ppm) {
+    signed char whole = (signed char)(ppm / TMR1_PPM_PER_COUNT);
+    int frac = ppm - whole * TMR1_PPM_PER_COUNT;
+    
+    if (frac < 0) {
+        frac += TMR1_PPM_PER_COUNT;
+        whole--;
+    }
+    PIE1bits.TMR1IE = 0;
+    tmr1_trim = whole;
+    tmr1_frac = (unsigned int)frac;
+    PIE1bits.TMR1IE = 1;
+}
+
+// Eroarea estimata a oscilatorului (ppm), refacuta din trim si rest. ISR
+// doar le citeste, deci nu e nevoie de citire atomica.
+int Time_Correction(void) {
+    return tmr1_trim * TMR1_PPM_PER_COUNT + (int)tmr1_frac;
+}
+
+// OSCTUNE ca numar cu semn (TUN<4:0> e in complement fata de 2)
+signed char Time_Tune(void) {
+    signed char tun = (signed char)(OSCTUNE & 0x1F);
+    
+    return (tun & 0x10) ? tun - 32 : tun;
+}
+
+// Secundele de la sincronizarea precedenta (TIME_AGE_MAX = prea multe);
+// numaratoarea reporneste. Citire atomica, ca getTicks().
+unsigned int Time_SyncAge(void) {
+    unsigned int age;
+    
+    PIE1bits.TMR1IE = 0;
+    age = time_sync_age;
+    time_sync_age = 0;
+    PIE1bits.TMR1IE = 1;
+    return age;
+}
+
+// Primeste abaterea ceasului PIC fata de ora ESP32 (ms), acumulata de la
+// sincronizarea precedenta, actualizeaza corectia si raspunde cu
+// TSYNC:OFS=<ms>,PPM=<ppm>,TUN=<osctune> (Time_SyncPart)
+void Time_Discipline(long ofs) {
+    unsigned int interval = Time_SyncAge();
+    signed char tun = Time_Tune();
+    
+    if (ofs > TIME_MAX_OFS_MS || ofs < -TIME_MAX_OFS_MS) return;
+    cmd_reply_arg = (int)(ofs > 32767L ? 32767L : (ofs < -32767L ? -32767L : ofs));
+    cmd_reply = CMD_REPLY_TSYNC;
+    
+    // Dupa ramura LOW_POWER, ofs se refoloseste pentru eroarea in ppm
+    if (interval >= TIME_MIN_INTERVAL && interval != TIME_AGE_MAX) {
+#if LOW_POWER
+        // A dormit mai mult de jumatate din interval: eroarea vine mai ales
+        // din perioada WDT creditata, nu din Timer1
+        if ((unsigned long)lp_slept_sync * 64UL > (unsigned long)interval * (TICKS_PER_SEC / 2)) {
+            lp_wdt_q12 += (int)((long)lp_wdt_q12 * ofs / ((long)lp_slept_sync * (64L * TICK_MS)) / 2);
+        } else
+#endif
+        // Jumatate din eroare: masurarea are o incertitudine de +/-1 tick
+        if ((ofs = ofs * 1000L / (long)interval) < TIME_MAX_PPM && ofs > -TIME_MAX_PPM) {
+            ofs = Time_Correction() + ofs / 2;
+            
+            // Pozitiv = PIC-ul merge incet; OSCTUNE mai mare = mai repede
+            if (ofs > TIME_OSCTUNE_PPM && tun < 15) {
+                tun++;
+                ofs -= OSCTUNE_STEP_PPM;
+            } else if (ofs < -TIME_OSCTUNE_PPM && tun > -16) {
+                tun--;
+                ofs += OSCTUNE_STEP_PPM;
+            }
+            OSCTUNE = (unsigned char)tun & 0x1F;
+            
+            if (ofs > TIME_MAX_PPM) ofs = TIME_MAX_PPM;
+            if (ofs < -TIME_MAX_PPM) ofs = -TIME_MAX_PPM;
+            Time_SetCorrection((int)ofs);
+        }
+    }
+}
+
+// Raspunsul TSYNC pe bucati (Cmd_ReplyPart): abaterea masurata, apoi
+// corectia si OSCTUNE de dupa ea; 0 dupa ultima bucata
+unsigned char Time_SyncPart(unsigned char part) {
+    switch (part) {
+        case 0:
+            UART_SendString("TSYNC:OFS=");
+            UART_SendInt(cmd_reply_arg);
+            return 1;
+        case 1:
+            UART_SendString(",PPM=");
+            UART_SendInt(Time_Correction());
+            return 1;
+        case 2:
+            UART_SendString(",TUN=");
+            UART_SendInt(Time_Tune());
+            UART_SendString("\r\n");
+            return 1;
+    }
+    return 0;
+}
+
+// "HH:MM:SS" (buf are cel putin 9 octeti)
+void RTC_FormatTime(const rtc_t *t, char *buf) {
+    buf[0] = (char)('0' + t->hour / 10);
+    buf[1] = (char)('0' + t->hour % 10);
+    buf[2] = ':';
+    buf[3] = (char)('0' + t->min / 10);
+    buf[4] = (char)('0' + t->min % 10);
+    buf[5] = ':';
+    buf[6] = (char)('0' + t->sec / 10);
+    buf[7] = (char)('0' + t->sec % 10);
+    buf[8] = '\0';
+}
+
+// "DD/MM/YYYY" (buf are cel putin 11 octeti)
+void RTC_FormatDate(const rtc_t *t, char *buf) {
+    buf[0] = (char)('0' + t->day / 10);
+    buf[1] = (char)('0' + t->day % 10);
+    buf[2] = '/';
+    buf[3] = (char)('0' + t->month / 10);
+    buf[4] = (char)('0' + t->month % 10);
+    buf[5] = '/';
+    buf[6] = '2';
+    buf[7] = '0';
+    buf[8] = (char)('0' + t->year / 10);
+    buf[9] = (char)('0' + t->year % 10);
+    buf[10] = '\0';
+}
+
+// Data din argv[0..2] (zi, luna, an complet); 0 daca nu e valida
+unsigned char RTC_SetDate(rtc_t *t, const int *argv) {
+    if (argv[2] < 2000 || argv[2] > 2099 || argv[1] < 1 || argv[1] > 12 || argv[0] < 1 ||
+        argv[0] > rtc_month_days[argv[1] - 1] + (argv[1] == 2 && (argv[2] & 3) == 0)) return 0;
+    t->day = (unsigned char)argv[0];
+    t->month = (unsigned char)argv[1];
+    t->year = (unsigned char)(argv[2] - 2000);
+    return 1;
+}
+
+// TIME:hh:mm:ss[.mmm][,zz/ll/aaaa] de la ESP32 (3, 4, 6 sau 7
+// numere). Data lipsa pastreaza data curenta.
+unsigned char Cmd_Time(const int *argv, unsigned char argc, unsigned char text) {
+    rtc_t t;
+    unsigned char ticks = 0, pic_ticks;
+    unsigned long pic_s;
+    (void)text;
+    
+    if (argc == 5) return CMD_ERR_ARGS;
+    if (argv[0] < 0 || argv[0] > 23 || argv[1] < 0 || argv[1] > 59 || argv[2] < 0 || argv[2] > 59) return CMD_ERR_ARGS;
+    pic_ticks = RTC_Get(&t);
+    pic_s = RTC_ToEpoch(&t);
+    t.hour = (unsigned char)argv[0];
+    t.min = (unsigned char)argv[1];
+    t.sec = (unsigned char)argv[2];
+    
+    // Milisecundele, la rezolutia unui tick
+    if (argc == 4 || argc == 7) {
+        if (argv[3] < 0 || argv[3] > 999) return CMD_ERR_ARGS;
+        ticks = (unsigned char)(argv[3] / TICK_MS);
+    }
+    if (argc >= 6 && !RTC_SetDate(&t, &argv[argc - 3])) return CMD_ERR_ARGS;
+    
+    if (time_valid) {
+        Time_Discipline((long)(RTC_ToEpoch(&t) - pic_s) * 1000L + ((int)ticks - (int)pic_ticks) * TICK_MS);
+    } else {
+        (void)Time_SyncAge();           // Primul interval incepe acum
+    }
+#if LOW_POWER
+    lp_slept_sync = 0;
+#endif
+    RTC_Set(&t, ticks);
+    time_valid = 1;
+    return CMD_OK;
+}
+
+unsigned char Cmd_Date(const int *argv, unsigned char argc, unsigned char text) {
+    rtc_t t;
+    unsigned char ticks = RTC_Get(&t);
+    (void)argc; (void)text;
+    
+    if (!RTC_SetDate(&t, argv)) return CMD_ERR_ARGS;
+    RTC_Set(&t, ticks);
+    return CMD_OK;
+}
+
+unsigned char Cmd_Rate(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argc; (void)text;
+    if (argv[0] < REPORT_RATE_MIN_S || argv[0] > REPORT_RATE_MAX_S) return CMD_ERR_ARGS;
+    report_rate = (unsigned char)argv[0];
+    Scheduler_Trigger(TASK_REPORT);
+    return CMD_OK;
+}
+
+unsigned char Cmd_Mode(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argc; (void)text;
+    if (argv[0] < DISP_WELCOME || argv[0] > DISP_TIME) return CMD_ERR_ARGS;
+    disp_mode = (unsigned char)argv[0];
+    Scheduler_Trigger(TASK_LCD);
+    return CMD_OK;
+}
+
+// Ca butonul de alarma: porneste sau rescrie numaratoarea; 0 o anuleaza
+unsigned char Cmd_Alarm(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argc; (void)text;
+    if (argv[0] < 0 || argv[0] > ALARM_MAX_S) return CMD_ERR_ARGS;
+    alarm_sec = (unsigned int)argv[0];
+    alarm_active = (argv[0] != 0);
+    Scheduler_Trigger(TASK_LCD);
+    return CMD_OK;
+}
+
+// Raspunsul este chiar ACK-ul
+unsigned char Cmd_Ping(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argv; (void)argc; (void)text;
+    return CMD_OK;
+}
+
+unsigned char Cmd_Fmt(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argv; (void)argc;
+    if (uart_rx_buf[text] == 'B') report_binary = 1;
+    else if (uart_rx_buf[text] == 'T') report_binary = 0;
+    else return CMD_ERR_ARGS;
+    rep_valid = 0;                          // Urmeaza raport complet
+    return CMD_OK;
+}
+
+unsigned char Cmd_Raw(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argc; (void)text;
+    if (argv[0] != 0 && argv[0] != 1) return CMD_ERR_ARGS;
+    report_raw = (argv[0] == 1);
+    rep_valid = 0;
+    return CMD_OK;
+}
+
+// BAUD:<rata> (raspuns BAUD:ACK / BAUD:NAK) sau BAUD:OK dupa SYNC
+unsigned char Cmd_Baud(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argv; (void)argc;
+    if (uart_rx_buf[text] == 'O' && uart_rx_buf[UART_RX_NEXT(text)] == 'K') {
+        if (uart_baud_state == UART_BAUD_TRIAL) uart_baud_state = UART_BAUD_FIXED;
+    } else if (!UART_Reserve(10)) {         // "BAUD:ACK\r\n"
+        return CMD_ERR_BUSY;
+    } else {
+        UART_RequestBaud(text);
+    }
+    return CMD_OK;
+}
+
+// Modelul de test se trimite inapoi neschimbat, intr-o singura linie;
+// ocupat pana e loc pentru ea (ESP32 repeta SYNC)
+unsigned char Cmd_Sync(const int *argv, unsigned char argc, unsigned char text) {
+    unsigned char len = 7, p;               // "SYNC:" si CRLF
+    (void)argv; (void)argc;
+    
+    for (p = text; uart_rx_buf[p]; p = UART_RX_NEXT(p)) len++;
+    if (len > UART_TX_MASK) return CMD_ERR_ARGS;
+    if (!UART_Reserve(len)) return CMD_ERR_BUSY;
+    UART_SendString("SYNC:");
+    for (; uart_rx_buf[text]; text = UART_RX_NEXT(text)) UART_SendByte(uart_rx_buf[text]);
+    UART_SendString("\r\n");
+    UART_Commit();
+    return CMD_OK;
+}
+
+// Confirmari si retransmisia jurnalului
+unsigned char Cmd_RxOk(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argv; (void)argc; (void)text;
+    Link_Alive();
+    return CMD_OK;
+}
+
+unsigned char Cmd_Backfill(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argv; (void)argc; (void)text;
+    if (!log_bf_active) {
+        log_bf_active = 1;
+        log_bf_slot = LOG_NONE;
+    }
+    return CMD_OK;
+}
+
+unsigned char Cmd_BfAck(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argc; (void)text;
+    if (log_bf_slot != LOG_NONE && argv[0] == EE_Read(EE_LOG_BASE + log_bf_slot * LOG_BLK_SIZE + LOG_OFS_SEQ)) log_bf_acked = 1;
+    return CMD_OK;
+}
+
+// Statisticile se trimit acum, nu la minutul urmator
+unsigned char Cmd_Stat(const int *argv, unsigned char argc, unsigned char text) {
+    (void)argv; (void)argc; (void)text;
+    Scheduler_Trigger(TASK_STATS);
+    return CMD_OK;
+}
+
+// Numele din tabela fata de cele len litere de la pos din buffer
+unsigned char Cmd_NameIs(const char *name, unsigned char pos, unsigned char len) {
+    for (unsigned char i = 0; i < len; i++, pos = UART_RX_NEXT(pos)) {
+        if (name[i] != uart_rx_buf[pos]) return 0;
+    }
+    return name[len] == '\0';
+}
+
+// O singura trecere prin linia de la pozitia line din bufferul de
+// receptie: numele, numerele (cu semn) in argv si locul #secventei. Linia
+// ramane neatinsa.
+void Cmd_Parse(unsigned char line, int *argv, cmd_line_t *cmd) {
+    unsigned int v = 0;
+    unsigned char p = line, idx, len = 0, argc = 0, digits = 0, neg = 0, err = CMD_OK;
+    
+    for (; uart_rx_buf[p] >= 'A' && uart_rx_buf[p] <= 'Z'; p = UART_RX_NEXT(p)) len++;
+    for (idx = 0; idx < NUM_CMDS && !Cmd_NameIs(cmds[idx].name, line, len); idx++);
+    if (uart_rx_buf[p] == ':') p = UART_RX_NEXT(p);
+    cmd->text = p;
+    
+    for (;; p = UART_RX_NEXT(p)) {
+        char c = uart_rx_buf[p];
+        
+        if (c >= '0' && c <= '9') {
+            if (v > 3276U) err = CMD_ERR_ARGS;  // Nu incape in int
+            v = v * 10U + (unsigned char)(c - '0');
+            digits = 1;
+            continue;
+        }
+        if (digits) {
+            if (v > 32767U) err = CMD_ERR_ARGS;
+            if (argc < CMD_MAX_ARGS) argv[argc] = neg ? -(int)v : (int)v;
+            if (argc < 0xFF) argc++;
+            v = 0;
+            digits = 0;
+        }
+        if (!c || c == '#') break;
+        neg = (c == '-');
+    }
+    
+    cmd->seq_pos = (uart_rx_buf[p] == '#') ? p : CMD_NO_SEQ;
+    cmd->idx = idx;
+    cmd->argc = argc;
+    cmd->err = err;
+}
+
+// Numarul de dupa '#' de la pozitia p
+unsigned int Cmd_Seq(unsigned char p) {
+    unsigned int v = 0;
+    
+    for (p = UART_RX_NEXT(p); uart_rx_buf[p] >= '0' && uart_rx_buf[p] <= '9'; p = UART_RX_NEXT(p)) {
+        v = v * 10U + (unsigned char)(uart_rx_buf[p] - '0');
+    }
+    return v;
+}
+
+// Interpreteaza linia de la pozitia line; raspunsul ei pleaca prin
+// Cmd_SendReply. Intoarce 0, fara sa execute nimic, doar daca linia are
+// nevoie de raspuns (#secventa sau CMD_REPLY_*) si cel precedent inca nu
+// a iesit; atunci linia ramane in buffer, neatinsa. Analiza e in
+// Cmd_Parse, ca variabilele ei sa nu stea pe stiva sub handler; pe stiva
+// raman doar argumentele si rezultatul analizei.
+unsigned char Cmd_Execute(unsigned char line) {
+    int argv[CMD_MAX_ARGS];
+    cmd_line_t cmd;
+    
+    Cmd_Parse(line, argv, &cmd);
+    if (CMD_REPLY_PENDING() && (cmd.seq_pos != CMD_NO_SEQ || (cmd.idx < NUM_CMDS && cmds[cmd.idx].reply != CMD_REPLY_NONE))) return 0;
+    
+    // Secventa taie si textul comenzilor CMD_TEXT
+    if (cmd.seq_pos != CMD_NO_SEQ) {
+        cmd_ack_seq = Cmd_Seq(cmd.seq_pos);
+        uart_rx_buf[cmd.seq_pos] = '\0';
+    }
+    
+    if (cmd.idx == NUM_CMDS) cmd.err = CMD_ERR_UNKNOWN;
+    else if (cmds[cmd.idx].max_args == CMD_TEXT) cmd.err = cmds[cmd.idx].run(argv, 0, cmd.text);
+    else if (!cmd.err && (cmd.argc < cmds[cmd.idx].min_args || cmd.argc > cmds[cmd.idx].max_args)) cmd.err = CMD_ERR_ARGS;
+    else if (!cmd.err) cmd.err = cmds[cmd.idx].run(argv, cmd.argc, cmd.text);
+    
+    if (cmd.seq_pos != CMD_NO_SEQ) {
+        cmd_ack_err = cmd.err;
+        cmd_ack = 1;
+    }
+    Cmd_SendReply();
+    return 1;
+}
+
+// Bucata part a raspunsului in asteptare: linia handler-ului, apoi
+// ACK:<n> sau NACK:<n>,<eroare>; 0 dupa ultima
+unsigned char Cmd_ReplyPart(unsigned char part) {
+    if (cmd_reply == CMD_REPLY_TSYNC && Time_SyncPart(part)) return 1;
+    if (cmd_reply == CMD_REPLY_CAL && Cal_ReplyPart(part)) return 1;
+    if (cmd_reply == CMD_REPLY_LOG && !part) {
+        UART_SendString("LOG:");
+        UART_SendUInt(Log_Pending());
+        UART_SendString("\r\n");
+        return 1;
+    }
+    if (cmd_ack) {
+        UART_SendString(cmd_ack_err ? "NACK:" : "ACK:");
+        UART_SendUInt(cmd_ack_seq);
+        if (cmd_ack_err) {
+            UART_SendByte(',');
+            UART_SendUInt(cmd_ack_err);
+        }
+        UART_SendString("\r\n");
+    }
+    return 0;
+}
+
+// Trimite cat incape din raspunsul in asteptare
+void Cmd_SendReply(void) {
+    if (CMD_REPLY_PENDING() && UART_SendParts(UART_OWNER_REPLY, Cmd_ReplyPart)) {
+        cmd_reply = CMD_REPLY_NONE;
+        cmd_ack = 0;
+    }
+}
+
+// Interpreteaza toate liniile terminate din bufferul de receptie
+void processUARTData(void) {
+    unsigned char end;
+    
+    Cmd_SendReply();
+    while (uart_rx_done != uart_rx_lines) {
+        for (end = uart_rx_tail; uart_rx_buf[end] > UART_RX_BAD; end = UART_RX_NEXT(end));
+        if (uart_rx_buf[end] == '\0' && !Cmd_Execute(uart_rx_tail)) break;   // Se reia dupa raspunsul precedent
+        uart_rx_tail = UART_RX_NEXT(end);   // Elibereaza linia pentru ISR
+        uart_rx_done++;
+    }
     
-    uart_index = 0;
-    uart_buffer[0] = '\0';
+    // Buffer plin fara nicio linie terminata: linia nu va incapea niciodata.
+    // ISR-ul a marcat-o deja, iar restul ei se termina cu UART_RX_BAD.
+    if (UART_RX_NEXT(uart_rx_head) == uart_rx_tail) {
+        PIE1bits.RCIE = 0;
+        if (uart_rx_done == uart_rx_lines) uart_rx_tail = uart_rx_head;
+        PIE1bits.RCIE = 1;
+    }
 }
 
 void setupTimer1(void) {
-    T1CON = 0x30; // Timer1 ON, prescaler 1:8
+    T1CON = 0x31; // Timer1 ON, prescaler 1:8
     TMR1H = TMR1_PRELOAD_H;
     TMR1L = TMR1_PRELOAD_L;
     PIE1bits.TMR1IE = 1; // Porneste intreruperea Timer1
@@ -754,32 +2979,756 @@ void setupTimer1(void) {
 void __interrupt() timer_isr(void) {
     // Intrerupere receptie UART
     if (PIR1bits.RCIF) {
+        // FERR tine de octetul din RCREG si trebuie citit inaintea lui
+        unsigned char framing = RCSTAbits.FERR;
         char received_char = RCREG;
+        unsigned char next = UART_RX_NEXT(uart_rx_head);
         
-        if (received_char == '\n' || received_char == '\r') {
-            uart_buffer[uart_index] = '\0';
-            uart_data_ready = 1;
-        } else if (uart_index < 63) {
-            uart_buffer[uart_index] = received_char;
-            uart_index++;
+        // Depasirea opreste receptorul pana la resetarea CREN; octetii
+        // pierduti rup linia curenta
+        if (RCSTAbits.OERR) {
+            RCSTAbits.CREN = 0;
+            RCSTAbits.CREN = 1;
+            if (uart_rx_errors < 0xFF) uart_rx_errors++;
+            if (uart_rx_overrun < 0xFF) uart_rx_overrun++;
+            uart_rx_bad = 1;
+        }
+        
+        if (framing) {
+            // Rata gresita sau zgomot - octetul se arunca. Intre linii
+            // (octetul de trezire, zgomot) nu strica urmatoarea comanda.
+            if (uart_rx_errors < 0xFF) uart_rx_errors++;
+            if (uart_rx_framing < 0xFF) uart_rx_framing++;
+            if (UART_RX_PARTIAL()) uart_rx_bad = 1;
+        } else if ((unsigned char)received_char <= UART_RX_BAD) {
+            // Octetul fals de dupa trezire; s-ar confunda cu terminatorul
+        } else if (received_char == '\n' || received_char == '\r') {
+            // Liniile goale (CR+LF, '\n'-ul de trezire) nu ocupa bufferul
+            if (UART_RX_PARTIAL()) {
+                if (next == uart_rx_tail) {
+                    // Buffer plin: terminatorul ia locul ultimului octet
+                    next = uart_rx_head;
+                    uart_rx_head = UART_RX_PREV(uart_rx_head);
+                    uart_rx_bad = 1;
+                }
+                uart_rx_buf[uart_rx_head] = uart_rx_bad ? UART_RX_BAD : '\0';
+                uart_rx_head = next;
+                uart_rx_lines++;
+            }
+            if (uart_rx_bad && uart_rx_lost < 0xFF) uart_rx_lost++;
+            uart_rx_bad = 0;
+        } else if (next == uart_rx_tail) {
+            uart_rx_bad = 1;            // Buffer plin
+        } else {
+            uart_rx_buf[uart_rx_head] = received_char;
+            uart_rx_head = next;
         }
         
         PIR1bits.RCIF = 0; // Sterge flag-ul
     }
     
+    // Schimbare pe RB0..RB3: citirea PORTB sterge nepotrivirea, iar
+    // apasarea e retinuta pana la urmatorul tick (si trezeste din SLEEP)
+    if (INTCONbits.RBIF) {
+        btn_edges |= (unsigned char)(~PORTB & 0x0F);
+        INTCONbits.RBIF = 0;
+    }
+    
+    // Intrerupere transmisie UART - trimite urmatorul octet din coada
+    if (PIE1bits.TXIE && PIR1bits.TXIF) {
+        if (uart_tx_tail != uart_tx_head) {
+            TXREG = uart_tx_buf[uart_tx_tail];
+            uart_tx_tail = (uart_tx_tail + 1U) & UART_TX_MASK;
+        } else {
+            PIE1bits.TXIE = 0; // Coada goala
+        }
+    }
+    
+    // Conversie ADC terminata - acumuleaza si trece la canalul urmator
+    if (PIR1bits.ADIF) {
+        PIR1bits.ADIF = 0;
+        adc_acc += ((unsigned int)ADRESH << 8) | ADRESL;
+        
+        if (++adc_count >= ADC_OVS_COUNT) {
+            adc_count = 0;
+            adc_result[adc_ch] = adc_acc >> ADC_DECIM_SHIFT;
+            adc_acc = 0;
+            if (++adc_ch >= ADC_NUM_CH) {
+                adc_ch = 0;
+                adc_ready = 1;
+            }
+            
+            // Achizitia pe noul canal dureaza pana la urmatorul tick
+            ADCON0 = (unsigned char)((ADCON0 & 0b11000011) | (adc_ch << 2));
+        }
+#if LOW_POWER
+        // Rafala: conversii back-to-back pana la setul complet
+        if (!adc_ready) {
+            __delay_us(LP_ADC_ACQ_US);
+            ADCON0bits.GO = 1;
+        }
+#endif
+    }
+    
     // Intrerupere Timer1
     if (PIR1bits.TMR1IF) {
+        unsigned int reload;
         PIR1bits.TMR1IF = 0;
 
-        TMR1H = TMR1_PRELOAD_H;
-        TMR1L = TMR1_PRELOAD_L;
+        // Reincarcare cu corectia de deriva; acumulatorul de faza adauga
+        // o numarare in tmr1_frac din 800 de tick-uri
+        reload = TMR1_PRELOAD + tmr1_trim;
+        tmr1_phase += tmr1_frac;
+        if (tmr1_phase >= TMR1_PPM_PER_COUNT) {
+            tmr1_phase -= TMR1_PPM_PER_COUNT;
+            reload++;
+        }
+        TMR1H = (unsigned char)(reload >> 8);
+        TMR1L = (unsigned char)reload;
 
+        sys_tick++;
         timer1_count++;
+        
+        if (!ADCON0bits.GO) ADCON0bits.GO = 1; // Urmatoarea conversie ADC
+        Buttons_Scan();
+
+        // LP_Idle adauga pana la o secunda dormita
+        while (timer1_count >= TICKS_PER_SEC) {
+            timer1_count -= TICKS_PER_SEC;
+            if (time_sync_age != TIME_AGE_MAX) time_sync_age++;
+            RTC_Tick();
+        }
+    }
+}
+
+// Citire atomica a contorului de tick-uri (16 biti pe un CPU de 8 biti)
+unsigned int getTicks(void) {
+    unsigned int t;
+    PIE1bits.TMR1IE = 0;
+    t = sys_tick;
+    PIE1bits.TMR1IE = 1;
+    return t;
+}
+
+// Planificator cooperativ
+void Scheduler_Init(void) {
+    unsigned int now = getTicks();
+    for (unsigned char i = 0; i < NUM_TASKS; i++) {
+        task_next[i] = now;
+        task_overrun[i] = 0;
+    }
+}
 
-        if (timer1_count >= 10) {
-            timer1_count = 0;
-            incrementTime(); // Incrementeaza doar daca timpul ESP32 nu e valid
+// Ruleaza taskurile scadente. Un task pornit cu mai mult de o perioada
+// dupa termen se contorizeaza ca depasire si isi reia ritmul de la acum.
+void Scheduler_Run(void) {
+    for (unsigned char i = 0; i < NUM_TASKS; i++) {
+        unsigned int late = getTicks() - task_next[i];
+        unsigned int period = tasks[i].period;
+        
+        if ((int)late < 0) continue; // Nu e inca timpul
+        
+        // Singura perioada schimbata de la distanta (RATE:)
+        if (i == TASK_REPORT) period = (unsigned int)report_rate * TICKS_PER_SEC;
+        if (late >= period) {
+            if (task_overrun[i] < 0xFF) task_overrun[i]++;
+            task_next[i] += late + period;  // De la acum
+        } else {
+            task_next[i] += period;
         }
+        tasks[i].run();
+    }
+}
+
+// Forteaza rularea unui task la urmatoarea trecere (ex: redesenare LCD)
+void Scheduler_Trigger(unsigned char task) {
+    task_next[task] = getTicks();
+}
+
+// Tick-uri pana la primul task scadent. Butoanele trezesc prin IOC, iar
+// SHT21 si legatura UART conteaza doar cat lucreaza (vezi LP_CanSleep).
+unsigned int Scheduler_IdleTicks(void) {
+    unsigned int now = getTicks(), idle = 0xFFFFU;
+    
+    for (unsigned char i = 0; i < NUM_TASKS; i++) {
+        unsigned int left = task_next[i] - now;
+        
+        if (i == TASK_TICK) continue;
+        if ((int)left <= 0) return 0;
+        if (left < idle) idle = left;
+    }
+    return idle;
+}
+
+#if LOW_POWER
+// SLEEP opreste ceasul UART si ADC-ul: nu se doarme cu transmisie sau
+// receptie in curs (si nici cu o linie sau un raspuns inca netrimis),
+// masurare SHT21, rafala ADC sau buton apasat (debounce-ul si apasarea
+// lunga numara tick-uri)
+unsigned char LP_CanSleep(void) {
+    return uart_tx_head == uart_tx_tail && TXSTAbits.TRMT &&
+           uart_tx_owner == UART_OWNER_NONE && !CMD_REPLY_PENDING() &&
+           uart_rx_head == uart_rx_tail && BAUDCTLbits.RCIDL &&
+           uart_baud_state == UART_BAUD_FIXED && sht_state == SHT21_IDLE &&
+           adc_ready && !ADCON0bits.GO &&
+           !btn_busy && btn_q_tail == btn_q_head &&
+           ee_wr_pos == EE_WR_IDLE && !sample_late && !log_bf_active;
+}
+
+// Doarme cea mai lunga perioada WDT care nu depaseste urmatorul termen
+void LP_Idle(void) {
+    unsigned int idle;
+    unsigned long credit;
+    unsigned char k = LP_WDTPS_MAX, woke_wdt;
+    
+    if (!LP_CanSleep()) return;
+    idle = Scheduler_IdleTicks();
+    if (idle > TICKS_PER_SEC) idle = TICKS_PER_SEC;  // timer1_count ramane sub 200
+    while (k > LP_WDTPS_MIN && (((unsigned long)lp_wdt_q12 << k) >> 12) > idle) k--;
+    credit = (unsigned long)lp_wdt_q12 << k;
+    if ((credit >> 12) > idle) return;
+    
+    ADCON0bits.ADON = 0;                // Perifericele nefolosite se opresc
+    BAUDCTLbits.WUE = 1;                // Frontul de start pe RX trezeste
+    WDTCON = (unsigned char)((k << 1) | 0x01);  // WDTPS = k, SWDTEN
+    
+    CLRWDT();
+    SLEEP();
+    NOP();
+    woke_wdt = !STATUSbits.nTO;         // 0 dupa depasirea WDT
+    
+    WDTCONbits.SWDTEN = 0;
+    BAUDCTLbits.WUE = 0;
+    ADCON0bits.ADON = 1;
+    
+    // Trezit de o intrerupere: momentul din perioada nu se stie, se
+    // creditaza jumatate
+    if (!woke_wdt) credit >>= 1;
+    credit += lp_credit_frac;
+    lp_credit_frac = (unsigned int)(credit & 0xFFF);
+    idle = (unsigned int)(credit >> 12);
+    
+    // Tick-urile dormite se adauga direct; secundele intregi le trece ISR-ul
+    // la urmatorul tick (RTC_Tick ramane doar in ISR)
+    PIE1bits.TMR1IE = 0;
+    sys_tick += idle;
+    timer1_count += (unsigned char)idle;
+    PIE1bits.TMR1IE = 1;
+    // Sincronizarea numara in pasi de 64 de tick-uri: transportul vine din
+    // bitii de jos ai contorului STAT
+    lp_slept_sync += ((lp_slept_stat & 0x3FU) + idle) >> 6;
+    lp_slept_stat += idle;
+}
+#endif
+
+// Taskurile de 10ms impart un termen si un contor de depasiri (3 B de
+// RAM pe task in planificator). Un esantion amanat de o scriere EEPROM
+// se reia aici, la primul tick dupa ea, fara sa ruleze iar Task_Second.
+void Task_Tick(void) {
+    Task_Buttons();
+    Task_SHT21();
+    Task_Link();
+    if (sample_late && !buzzer_on) Task_Sample();
+}
+
+// Esantionarea nu ruleaza cat tine alarma, deci cele doua taskuri de 1s
+// impart un termen. Esantionul asteapta si secunda bipului final: o
+// rulare repetata (Scheduler_Trigger) nu scurteaza bipul.
+void Task_Second(void) {
+    Task_Alarm();
+    if (!buzzer_on) Task_Sample();
+    
+    // ESP32 nu a confirmat de mult: un esantion pe minut in EEPROM
+    if (!link_up) Log_Append();
+}
+
+// Butonul de alarma: apasare = +15s (porneste alarma daca e oprita),
+// apasare lunga = anuleaza alarma. Butoanele RB0..RB3 schimba ecranul.
+void Task_Buttons(void) {
+    unsigned char ev;
+    
+    while ((ev = Buttons_GetEvent()) != BTN_EV_NONE) {
+        unsigned char type = ev & 0xF0;
+        
+        if ((ev & 0x0F) == BTN_ALARM) {
+            if (type == BTN_EV_PRESS) {
+                if(alarm_active) alarm_sec += 15;
+                else { alarm_sec = 15; alarm_active = 1; }
+            } else if (type == BTN_EV_LONG && alarm_active) {
+                alarm_active = 0;
+                alarm_sec = 0;
+            }
+            Scheduler_Trigger(TASK_LCD);
+        } else if (!alarm_active && type == BTN_EV_PRESS) {
+            switch (ev & 0x0F) {
+                case 2: disp_mode = DISP_LM35; break;   // RB2
+                case 0: disp_mode = DISP_SHT21; break;  // RB0
+                case 3: disp_mode = DISP_LDR; break;    // RB3
+                default: disp_mode = DISP_TIME; break;  // RB1
+            }
+            Scheduler_Trigger(TASK_LCD);
+        }
+    }
+}
+
+void Task_Sample(void) {
+    sample_late = 0;
+    if(alarm_active || !adc_ready) return;
+    
+    // Calibrarea se citeste din EEPROM: esantionul asteapta sfarsitul
+    // scrierii in curs, fara sa blocheze bucla principala
+    sample_late = (ee_wr_pos != EE_WR_IDLE || EECON1bits.WR);
+    if (sample_late) return;
+    
+    temp1 = Report_Track(LM35_CHANNEL, temp1, Filter_Update(LM35_CHANNEL, Cal_Apply(LM35_CHANNEL, getLM35Temperature())));
+    // HIH-5030 se compenseaza cu temperatura SHT21 (mai precisa), iar
+    // cat timp aceasta lipseste, cu LM35
+    humid1 = Report_Track(HIH_CHANNEL, humid1, Filter_Update(HIH_CHANNEL, Cal_Apply(HIH_CHANNEL, getHIH5030Humidity(err_temp ? temp1 : temp2))));
+    light = Report_Track(LDR_CHANNEL, light, Filter_Update(LDR_CHANNEL, Cal_Apply(LDR_CHANNEL, getLDRValue())));
+    Filter_Advance();
+    
+    // Un senzor a cazut sau si-a revenit: raportul nu asteapta
+    if (Report_Valid() != rep_valid) Scheduler_Trigger(TASK_REPORT);
+    
+    // Rezultatele SHT21 sosesc asincron, prin Task_SHT21
+    SHT21_BeginCycle();
+    
+#if LOW_POWER
+    // Setul ADC pentru urmatorul esantion se face dintr-o rafala (~3ms),
+    // apoi convertorul poate fi oprit in SLEEP. adc_ready revine la 1
+    // cand rafala se termina.
+    adc_ready = 0;
+    if (!ADCON0bits.GO) ADCON0bits.GO = 1;
+#endif
+}
+
+// Valoarea canalului i din raport, fara copie pe stiva
+int Report_Value(unsigned char i) {
+    switch (i) {
+        case 0: return temp1;
+        case 1: return humid1;
+        case 2: return light;
+        case 3: return temp2;
+        default: return humid2;
+    }
+}
+
+// Bitmap de validitate T1, H1, L, T2, H2
+unsigned char Report_Valid(void) {
+    unsigned char valid = 0x07;             // Senzorii analogici sunt mereu valizi
+    
+    if (!err_temp) valid |= 0x08;
+    if (!err_humid) valid |= 0x10;
+    return valid;
+}
+
+// Noua valoare a canalului i; adauga miscarea la rep_move[i]
+int Report_Track(unsigned char i, int old, int now) {
+    int m = rep_move[i];
+    
+    // Saturat: suma reala nu se mai stie, canalul asteapta trimiterea
+    if (m == REPORT_MOVE_MAX || m == -REPORT_MOVE_MAX) return now;
+    m += now - old;
+    if (m > REPORT_MOVE_MAX) m = REPORT_MOVE_MAX;
+    if (m < -REPORT_MOVE_MAX) m = -REPORT_MOVE_MAX;
+    rep_move[i] = (signed char)m;
+    return now;
+}
+
+// Canalele de trimis acum (REPORT_ALL = raport complet, 0 = nimic)
+unsigned char Report_Select(void) {
+    unsigned char valid = Report_Valid(), mask = 0;
+    
+    if (valid != rep_valid || TICKS64_SINCE(rep_full_tick) >= MS_TO_TICKS64(REPORT_HEARTBEAT_MS)) return REPORT_ALL;
+    
+    for (unsigned char i = 0; i < REPORT_NUM_FIELDS; i++) {
+        if (!(valid & (1U << i))) continue;
+        if (rep_move[i] >= rep_deadband[i] || rep_move[i] <= -rep_deadband[i]) mask |= (unsigned char)(1U << i);
+    }
+    return mask;
+}
+
+// Raportul text pentru canalele din rep_text, pe bucati:
+// Complet:  T1:..,H1:..,L:..,LX:..,T2:..,H2:..,R2:..
+// Partial:  UPD:<doar canalele din mask, LX dupa L>
+// Bucatile 0..4 sunt canalele, 5 sfarsitul liniei. Cu RAW:1, raportul
+// complet e urmat de RAW:T1R:..,H1R:..,LR:.. (bucatile 6..8), valorile
+// nefiltrate, pe linia lor. Intoarce 0 dupa ultima bucata.
+unsigned char Report_TextPart(unsigned char part) {
+    unsigned char bit;
+    
+    if (part < REPORT_NUM_FIELDS) {
+        bit = (unsigned char)(1U << part);
+        if (!(rep_text & bit)) return 1;
+        if (rep_text & (bit - 1U)) UART_SendByte(',');
+        else if (rep_text != REPORT_ALL) UART_SendString("UPD:");
+        UART_SendString(rep_names[part]);
+        if (rep_valid & bit) UART_SendFixed(Report_Value(part), rep_precision[part]);
+        else UART_SendString("ERR");
+        if (part == LDR_CHANNEL) {
+            UART_SendString(",LX:");
+            UART_SendUInt(Light_Lux(light));
+        }
+        return 1;
+    }
+    
+    switch (part - REPORT_NUM_FIELDS) {
+        case 0:
+            if (rep_text == REPORT_ALL) {
+                UART_SendString(",R2:");
+                UART_SendUInt(sht_sample_res);
+            }
+            UART_SendString("\r\n");
+            return rep_text == REPORT_ALL && report_raw;
+        case 1:
+            UART_SendString("RAW:T1R:");
+            UART_SendFixed(Filter_Raw(LM35_CHANNEL), 1);
+            return 1;
+        case 2:
+            UART_SendString(",H1R:");
+            UART_SendFixed(Filter_Raw(HIH_CHANNEL), 0);
+            return 1;
+    }
+    UART_SendString(",LR:");
+    UART_SendFixed(Filter_Raw(LDR_CHANNEL), 0);
+    UART_SendString("\r\n");
+    return 0;
+}
+
+// 21 de octeti pe legatura, fata de ~45 in format text; un cadru partial
+// cu un canal are 9 (11 cu L si luxul)
+void Report_SendBinary(unsigned char mask, unsigned int lux) {
+    unsigned char frame[FRAME_SAMPLE_RAW_LEN];
+    unsigned int crc = CRC16_INIT;
+    unsigned char i, n = 4;
+    
+    frame[1] = report_seq++;
+    if (mask == REPORT_ALL) {
+        frame[0] = report_raw ? FRAME_SAMPLE_RAW : FRAME_SAMPLE;
+        frame[2] = rep_valid;
+        frame[3] = sht_sample_res;
+    } else {
+        frame[0] = FRAME_UPDATE;
+        frame[2] = mask;
+        n = 3;
+    }
+    for (i = 0; i < REPORT_NUM_FIELDS; i++) {
+        if (!(mask & (1U << i))) continue;
+        unsigned int v = (unsigned int)Report_Value(i);
+        frame[n++] = (unsigned char)v;
+        frame[n++] = (unsigned char)(v >> 8);
+    }
+    if (mask & (1U << LDR_CHANNEL)) {
+        frame[n++] = (unsigned char)lux;
+        frame[n++] = (unsigned char)(lux >> 8);
+    }
+    if (mask == REPORT_ALL && report_raw) {
+        for (i = 0; i < ADC_NUM_CH; i++) {
+            int raw = Filter_Raw(i);
+            frame[n++] = (unsigned char)raw;
+            frame[n++] = (unsigned char)((unsigned int)raw >> 8);
+        }
+    }
+    for (i = 0; i < n; i++) crc = CRC16_Update(crc, frame[i]);
+    frame[n++] = (unsigned char)crc;
+    frame[n++] = (unsigned char)(crc >> 8);
+    
+    UART_SendCOBS(frame, n);
+    UART_Commit();
+}
+
+void Task_Report(void) {
+    unsigned char mask;
+    
+    if (!rep_text) {
+        // Cadrul binar nu se trimite pe jumatate: se asteapta loc pentru el
+        if (report_binary && !UART_Reserve(FRAME_COBS_MAX)) {
+            Scheduler_Trigger(TASK_REPORT);
+            return;
+        }
+        
+        mask = Report_Select();
+        if (mask == REPORT_ALL) {
+            rep_valid = Report_Valid();
+            rep_full_tick = TICKS64();
+        } else if (mask) {
+            if (rep_partial < 0xFF) rep_partial++;
+        } else if (rep_skipped < 0xFF) {
+            rep_skipped++;
+        }
+        
+        for (unsigned char i = 0; i < REPORT_NUM_FIELDS; i++) {
+            if (mask & (1U << i)) rep_move[i] = 0;
+        }
+        // Luxul se calculeaza aici, nu sub cadrul de 24 B al raportului
+        if (mask && report_binary) Report_SendBinary(mask, Light_Lux(light));
+        else rep_text = mask;
+    }
+    
+    // Raportul text pleaca pe bucati, pe masura ce se elibereaza coada
+    if (rep_text) {
+        if (UART_SendParts(UART_OWNER_REPORT, Report_TextPart)) rep_text = 0;
+        else Scheduler_Trigger(TASK_REPORT);
+    }
+}
+
+void Task_Alarm(void) {
+    if(buzzer_on) {
+        BUZZER_PIN = 0;
+        buzzer_on = 0;
+    }
+    if(!alarm_active) return;
+    
+    // alarm_end nu se pierde: secunda se reia cand e loc in coada
+    if (alarm_sec == 1 && !UART_Reserve(11)) {
+        Scheduler_Trigger(TASK_SECOND);
+        return;
+    }
+    alarm_sec--;
+    if(alarm_sec == 0) {
+        BUZZER_PIN = 1;      // Oprit la urmatoarea rulare (1s)
+        buzzer_on = 1;
+        alarm_active = 0;
+        UART_SendString("alarm_end\r\n");
+        UART_Commit();
+    }
+    Scheduler_Trigger(TASK_LCD);
+}
+
+// Reconstruieste ecranul in framebuffer si trimite doar diferentele
+void Task_LCD(void) {
+    rtc_t now;
+    char buf[11];
+    
+    if(alarm_active) {
+        displayAlarmCountdown(alarm_sec);
+        LCDFB_Flush();
+        return;
+    }
+    
+    LCDFB_Goto(0, 0);
+    
+    switch(disp_mode) {
+        case DISP_WELCOME:
+            LCDFB_String(welcome1);
+            LCDFB_ClearEOL();
+            LCDFB_Goto(1, 0);
+            LCDFB_String(welcome2);
+            break;
+        
+        case DISP_LM35:
+            LCDFB_String("LM35 T: ");
+            LCD_WriteTemp(temp1);
+            LCDFB_ClearEOL();
+            LCDFB_Goto(1, 0);
+            LCDFB_String("HIH H: ");
+            LCD_WriteInt((humid1 + 5) / 10);
+            LCDFB_Char('%');
+            break;
+        
+        case DISP_SHT21:
+            LCDFB_String("SHT21 T: ");
+            if(!err_temp) LCD_WriteTemp(temp2);
+            else LCDFB_String("Eroare");
+            LCDFB_ClearEOL();
+            LCDFB_Goto(1, 0);
+            LCDFB_String("SHT21 H: ");
+            if(!err_humid) { LCD_WriteInt((humid2 + 5) / 10); LCDFB_Char('%'); }
+            else LCDFB_String("Eroare");
+            break;
+        
+        case DISP_LDR:
+            LCDFB_String("Nivel Lumina:");
+            LCDFB_ClearEOL();
+            LCDFB_Goto(1, 0);
+            LCD_WriteInt((light + 5) / 10);
+            LCDFB_String("%  ");
+            LCD_WriteUInt(Light_Lux(light));
+            LCDFB_String(" lx");
+            break;
+        
+        case DISP_TIME:
+            (void)RTC_Get(&now);
+            LCDFB_String("Timpul Curent:");
+            LCDFB_ClearEOL();
+            LCDFB_Goto(1, 0);
+            RTC_FormatTime(&now, buf);
+            LCDFB_String(buf);
+            LCDFB_String("  ");
+            RTC_FormatDate(&now, buf);
+            buf[5] = '\0';             // Doar DD/MM - randul are 16 coloane
+            LCDFB_String(buf);
+            break;
+            
+        default:
+            disp_mode = DISP_WELCOME;
+            LCDFB_ClearEOL();
+            LCDFB_Goto(1, 0);
+            break;
+    }
+    LCDFB_ClearEOL();
+    LCDFB_Flush();
+}
+
+// Supravegherea legaturii UART: schimbarea de rata dupa BAUD:ACK si
+// revenirea la 9600 daca rata noua nu e confirmata sau produce erori
+void Task_Link(void) {
+    EE_Service();
+    Log_Service();
+    if (link_up && TICKS64_SINCE(link_rx_tick) >= MS_TO_TICKS64(LINK_TIMEOUT_MS)) link_up = 0;
+    
+    if (uart_baud_state == UART_BAUD_PENDING) {
+        // Raspunsul trebuie sa iasa complet la rata veche
+        if (uart_tx_head != uart_tx_tail || !TXSTAbits.TRMT) return;
+        UART_SetBaud(uart_baud_next);
+        uart_baud_since = TICKS8();
+        uart_baud_state = UART_BAUD_TRIAL;
+        return;
+    }
+    
+    if (uart_baud == UART_BAUD_DEFAULT) return;
+    
+    if (uart_rx_errors >= UART_ERR_MAX ||
+        (uart_baud_state == UART_BAUD_TRIAL &&
+         TICKS8_SINCE(uart_baud_since) >= MS_TO_TICKS(UART_TRIAL_MS))) {
+        UART_Fallback();
+    } else if (TICKS8_SINCE(uart_err_window) >= TICKS_PER_SEC) {
+        uart_err_window = TICKS8();     // Erorile izolate nu se aduna
+        uart_rx_errors = 0;
+    }
+}
+
+// Raporteaza contoarele de diagnostic:
+// STAT:OV=a/b/c/d/e,TXHW=n,TXOV=n,LCDW=n,LCDUS=n,SHTT=n/n,SHTH=n/n,
+//      SHTCRC=n/n,SHTRTY=n/n,BAUD=n/n,PPM=n,LOG=n/n,RPT=n/n,RX=n/n/n,BTN=n
+//      [,AWAKE=n]
+// OV = termene ratate: taskul de 10ms (butoane, SHT21, legatura), cel
+//      de 1s (alarma, esantionare), LCD, raport, statistici
+// LCDW = octeti trimisi la LCD, LCDUS = asteptarea medie pe octet (us)
+// SHTT/SHTH = timpul de conversie SHT21 (ultimul/maxim, ms)
+// SHTCRC/SHTRTY = cadre SHT21 cu CRC invalid / remasurari (T/RH)
+// BAUD = rata UART activa / reveniri automate la 9600
+// PPM = eroarea estimata a oscilatorului (corectia ceasului aplicata)
+// LOG = esantioane din EEPROM neconfirmate / neconfirmate suprascrise
+// RPT = rapoarte partiale / omise (banda moarta), de la ultimul STAT
+// RX = depasiri (OERR) / erori de cadru (FERR) / linii aruncate la receptie
+// BTN = evenimente de buton pierdute (coada plina)
+// AWAKE = timpul petrecut treaz de la ultimul STAT, in promile (LOW_POWER)
+// Contoarele OV, TXOV, SHTCRC, SHTRTY, BAUD, RPT, RX, BTN si al doilea
+// camp LOG se opresc la 255.
+// Linia e trimisa camp cu camp (UART_SendParts), deci poate fi mai lunga
+// decat coada de transmisie; pana la ultimul camp celelalte linii asteapta.
+
+// Trimite campul cu numarul dat; intoarce 0 dupa ultimul camp
+unsigned char Stats_SendField(unsigned char field) {
+    unsigned char idx;
+    
+    if (field < NUM_TASKS) {
+        UART_SendString(field ? "/" : "STAT:OV=");
+        UART_SendUInt(task_overrun[field]);
+        return 1;
+    }
+    
+    switch (field - NUM_TASKS) {
+        case 0:
+            UART_SendString(",TXHW=");
+            UART_SendUInt(uart_tx_hwm);
+            break;
+        case 1:
+            UART_SendString(",TXOV=");
+            UART_SendUInt(uart_tx_overflow);
+            break;
+        case 2:
+            UART_SendString(",LCDW=");
+            UART_SendUInt(lcd_writes);
+            break;
+        case 3:
+            UART_SendString(",LCDUS=");
+            UART_SendUInt(lcd_writes ? (unsigned int)(lcd_wait * 10UL / lcd_writes) : 0U);
+            lcd_writes = 0;
+            lcd_wait = 0;
+            break;
+        case 4:
+        case 5:
+            idx = field - NUM_TASKS - 4;
+            UART_SendString(idx ? ",SHTH=" : ",SHTT=");
+            UART_SendUInt(sht_conv_last[idx]);
+            UART_SendByte('/');
+            UART_SendUInt(sht_conv_max[idx]);
+            break;
+        case 6:
+            UART_SendString(",SHTCRC=");
+            UART_SendUInt(sht_crc_fail[0]);
+            UART_SendByte('/');
+            UART_SendUInt(sht_crc_fail[1]);
+            break;
+        case 7:
+            UART_SendString(",SHTRTY=");
+            UART_SendUInt(sht_retries[0]);
+            UART_SendByte('/');
+            UART_SendUInt(sht_retries[1]);
+            break;
+        case 8:
+            UART_SendString(",BAUD=");
+            UART_SendUInt(uart_baud_div10[uart_baud]);
+            UART_SendByte('0');
+            UART_SendByte('/');
+            UART_SendUInt(uart_fallbacks);
+            break;
+        case 9:
+            UART_SendString(",PPM=");
+            UART_SendInt(Time_Correction());
+            break;
+        case 10:
+            UART_SendString(",LOG=");
+            UART_SendUInt(Log_Pending());
+            UART_SendByte('/');
+            UART_SendUInt(log_dropped);
+            break;
+        case 11:
+            UART_SendString(",RPT=");
+            UART_SendUInt(rep_partial);
+            UART_SendByte('/');
+            UART_SendUInt(rep_skipped);
+            rep_partial = 0;
+            rep_skipped = 0;
+            break;
+        case 12:
+            UART_SendString(",RX=");
+            UART_SendUInt(uart_rx_overrun);
+            UART_SendByte('/');
+            UART_SendUInt(uart_rx_framing);
+            UART_SendByte('/');
+            UART_SendUInt(uart_rx_lost);
+            break;
+        case 13:
+            UART_SendString(",BTN=");
+            UART_SendUInt(btn_q_overflow);
+            break;
+#if LOW_POWER
+        case 14: {
+            unsigned int elapsed = (unsigned int)TICKS64_SINCE(lp_stat_tick) << 6;
+            
+            // Fereastra se masoara in pasi de 64 de tick-uri, deci somnul o
+            // poate depasi cu cel mult un pas
+            UART_SendString(",AWAKE=");
+            UART_SendUInt(elapsed > lp_slept_stat ? (unsigned int)((elapsed - lp_slept_stat) * 1000UL / elapsed) : 0U);
+            // Restul sub 64 de tick-uri ramane pentru lp_slept_sync
+            lp_slept_stat &= 0x3FU;
+            lp_stat_tick = TICKS64();
+            break;
+        }
+#endif
+        default:
+            UART_SendString("\r\n");
+            return 0;
+    }
+    return 1;
+}
+
+void Task_Stats(void) {
+    if (!UART_SendParts(UART_OWNER_STAT, Stats_SendField)) {
+        Scheduler_Trigger(TASK_STATS);  // Continua cand se elibereaza coada
     }
 }
 
@@ -800,121 +3749,27 @@ void main(void) {
     LCD_Command(0x80);
     LCD_String("Sistem Gata");
     __delay_ms(2000);
-    
-    unsigned char disp_mode = DISP_WELCOME, alarm_active = 0, data_cnt = 0;
-    unsigned int alarm_sec = 0;
+    LCDFB_Init();
+    Log_Init();
+    report_raw = REPORT_RAW_DEFAULT;
+    report_binary = REPORT_BINARY_DEFAULT;
     
     UART_SendString("PIC16F887 Porneste\r\n");
+    UART_Commit();
     INTCONbits.GIE = 1;
+    
+    Scheduler_Init();
+
+#if LOW_POWER
+    OPTION_REGbits.PSA = 0;    // Prescalerul la Timer0, WDT doar cu WDTPS
+    WDTCON = 0;
+#endif
 
     while(1) {
         processUARTData();
-        
-        // Verifica butoanele
-        if(isButtonPressed(4)) { // RA4 - Alarma
-            if(alarm_active) alarm_sec += 15;
-            else { alarm_sec = 15; alarm_active = 1; }
-        }
-        
-        if(!alarm_active) {
-            if(isButtonPressed(2)) { disp_mode = DISP_LM35; LCD_Command(0x01); }      // RB2
-            else if(isButtonPressed(0)) { disp_mode = DISP_SHT21; LCD_Command(0x01); } // RB0
-            else if(isButtonPressed(3)) { disp_mode = DISP_LDR; LCD_Command(0x01); }   // RB3
-            else if(isButtonPressed(1)) { disp_mode = DISP_TIME; LCD_Command(0x01); }  // RB1
-        }
-        
-        if(alarm_active) {
-            displayAlarmCountdown(alarm_sec);
-            __delay_ms(1000);
-            alarm_sec--;
-            if(alarm_sec == 0) {
-                soundBuzzer(1000);
-                alarm_active = 0;
-                UART_SendString("alarm_end\r\n");
-            }
-        } else {
-            float temp1 = getLM35Temperature(), humid1 = getHIH5030Humidity(), light = getLDRValue();
-            unsigned int raw_temp = 0, raw_humid = 0;
-            unsigned char err_temp = 0, err_humid = 0;
-            float temp2 = 0.0, humid2 = 0.0;
-            
-            err_temp = SHT21_Measure(SHT21_CMD_MEASURE_TEMP_NO_HOLD, &raw_temp);
-            if(!err_temp) {
-                temp2 = SHT21_CalcTemperature(raw_temp);
-                __delay_ms(10); 
-                err_humid = SHT21_Measure(SHT21_CMD_MEASURE_HUMID_NO_HOLD, &raw_humid);
-                if(!err_humid) humid2 = SHT21_CalcHumidity(raw_humid);
-            }
-            
-            if(++data_cnt >= 5) {
-                UART_SendString("T1:");
-                UART_SendFloat(temp1, 1);
-                UART_SendString(",H1:");
-                UART_SendFloat(humid1, 0);
-                UART_SendString(",L:");
-                UART_SendFloat(light, 0);
-                UART_SendString(",T2:");
-                if (!err_temp) UART_SendFloat(temp2, 1);
-                else UART_SendString("ERR");
-                UART_SendString(",H2:");
-                if (!err_humid) UART_SendFloat(humid2, 0);
-                else UART_SendString("ERR");
-                UART_SendString("\r\n");
-                data_cnt = 0;
-            }
-            
-            LCD_Command(0x01);
-            __delay_ms(5);
-            LCD_Command(0x80);
-            
-            switch(disp_mode) {
-                case DISP_WELCOME:
-                    LCD_String(welcome1);
-                    LCD_Command(0xC0);
-                    LCD_String(welcome2);
-                    __delay_ms(200);
-                    break;
-                
-                case DISP_LM35:
-                    LCD_String("LM35 T: ");
-                    LCD_WriteTemp(temp1);
-                    LCD_Command(0xC0);
-                    LCD_String("HIH H: ");
-                    LCD_WriteInt((int)(humid1 + 0.5f));
-                    LCD_Char('%');
-                    __delay_ms(1000);
-                    break;
-                
-                case DISP_SHT21:
-                    LCD_String("SHT21 T: ");
-                    if(!err_temp) LCD_WriteTemp(temp2);
-                    else LCD_String("Eroare");
-                    LCD_Command(0xC0);
-                    LCD_String("SHT21 H: ");
-                    if(!err_humid) { LCD_WriteInt((int)(humid2 + 0.5f)); LCD_Char('%'); }
-                    else LCD_String("Eroare");
-                    __delay_ms(1000);
-                    break;
-                
-                case DISP_LDR:
-                    LCD_String("Nivel Lumina:");
-                    LCD_Command(0xC0);
-                    LCD_WriteInt((int)(light + 0.5f));
-                    LCD_Char('%');
-                    __delay_ms(1000);
-                    break;
-                
-                case DISP_TIME:
-                    LCD_String("Timpul Curent:");
-                    LCD_Command(0xC0);
-                    LCD_String(time_str);
-                    __delay_ms(1000);
-                    break;
-                    
-                default:
-                    disp_mode = DISP_WELCOME;
-                    break;
-            }
-        }
+        Scheduler_Run();
+#if LOW_POWER
+        LP_Idle();
+#endif
     }
 }
@@ -0,0 +1,67 @@
+// Test pe calculator: tabelul hih_rh_lut[] si getHIH5030Humidity() fata de
+// ecuatia din foaia de catalog HIH-5030, pe tot domeniul ADC si de
+// temperatura al tabelului. Din radacina depozitului:
+//   gcc -std=c99 -Itests -o hih_lut_test tests/hih_lut_test.c -lm
+//   ./hih_lut_test          verifica eroarea maxima (cod de iesire 1 peste limita)
+//   ./hih_lut_test gen      tipareste tabelul recalculat, pentru PIC16F887.c
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define main pic_main
+#include "../PIC16F887.c"
+#undef main
+
+#define MAX_ERR_TENTHS  1.0         // 0.1 %RH, ca in README
+
+// RH adevarat (%) din raportul Vout/Vs si temperatura (C):
+// Vout = Vs * (0.00636 * RH_senzor + 0.1515), RH = RH_senzor / (1.0546 - 0.00216 * T)
+static double hih_datasheet(double ratio, double temp_c) {
+    return (ratio - 0.1515) / 0.00636 / (1.0546 - 0.00216 * temp_c);
+}
+
+static void print_table(void) {
+    for (int r = 0; r < HIH_LUT_ROWS; r++) {
+        double temp_c = (HIH_LUT_T0 + (r << HIH_LUT_TSHIFT)) / 10.0;
+        
+        printf("    {");
+        for (int c = 0; c < HIH_LUT_COLS; c++) {
+            double rh = hih_datasheet((double)c / (HIH_LUT_COLS - 1), temp_c);
+            printf("%s%5ld", c ? ", " : "", lround(rh * 100.0));
+        }
+        printf("}%s   // %+.1fC\n", r < HIH_LUT_ROWS - 1 ? "," : " ", temp_c);
+    }
+}
+
+int main(int argc, char **argv) {
+    double max_err = 0.0;
+    unsigned int worst_adc = 0;
+    int worst_temp = 0;
+    
+    if (argc > 1 && strcmp(argv[1], "gen") == 0) {
+        print_table();
+        return 0;
+    }
+    
+    for (unsigned int adc = 0; adc < ADC_FULL_SCALE; adc++) {
+        adc_result[HIH_CHANNEL] = adc;
+        for (int temp = HIH_LUT_T0; temp <= HIH_LUT_TMAX; temp++) {
+            double ref = hih_datasheet((double)adc / ADC_FULL_SCALE, temp / 10.0) * 10.0;
+            double err;
+            
+            if (ref < 0.0) ref = 0.0;
+            if (ref > 1000.0) ref = 1000.0;
+            err = fabs(getHIH5030Humidity(temp) - ref);
+            if (err > max_err) {
+                max_err = err;
+                worst_adc = adc;
+                worst_temp = temp;
+            }
+        }
+    }
+    
+    printf("HIH LUT: eroare maxima %.2f zecimi de %%RH (ADC %u, %.1fC), limita %.1f\n",
+           max_err, worst_adc, worst_temp / 10.0, MAX_ERR_TENTHS);
+    return max_err <= MAX_ERR_TENTHS ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Test pe calculator: jurnalul EEPROM (Log_Append) scris cu EEPROM-ul
+// simulat si decodat independent, dupa formatul din README (antet de 16
+// octeti, apoi cifre hexa: diferenta + 7, 0xE + valoarea pe 16 biti,
+// 0xF = sfarsit). Din radacina depozitului:
+//   gcc -std=c99 -Itests -o log_test tests/log_test.c -lm
+//   ./log_test              cod de iesire 1 daca o verificare esueaza
+// Verifica: valorile si orele decodate sunt cele salvate, cu valori care
+// variaza lent, cu salturi (cifre 0xE) si cu un reset in mijlocul unei
+// scrieri (blocul vechi ramane intreg, esantionul se reia intr-un bloc
+// nou); valorile lente intra de cel putin LOG_MIN_RATIO ori mai compact
+// decat brute (10 octeti pe esantion).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xc.h>
+
+// EEPROM-ul de date: EEDATA e celula de la EEADR, iar o scriere pornita
+// (WR = 1) se termina la urmatorul acces la EECON1
+static unsigned char ee_mem[256];
+static volatile struct xc_bits *ee_con1(void) {
+    EECON1bits.WR = 0;
+    return &EECON1bits;
+}
+#define EEDATA      ee_mem[EEADR]
+#define EECON1bits  (*ee_con1())
+
+#define main pic_main
+#include "../PIC16F887.c"
+#undef main
+
+#define LOG_MIN_RATIO   3.0         // 20 de esantioane de 10 B intr-un bloc de 64 B
+#define MAX_SAMPLES     400
+
+static int hist[MAX_SAMPLES][REPORT_NUM_FIELDS];    // Valorile date lui Log_Append
+static unsigned long hist_epoch[MAX_SAMPLES];
+static int dec_val[MAX_SAMPLES][REPORT_NUM_FIELDS]; // Valorile decodate
+static unsigned long dec_epoch[MAX_SAMPLES];
+
+static unsigned char nibble(const unsigned char *blk, int n) {
+    unsigned char b = blk[LOG_OFS_DATA + n / 2];
+    return (n & 1) ? (b & 0x0F) : (b >> 4);
+}
+
+// Decodeaza un bloc la sfarsitul listei; intoarce numarul de esantioane
+static int decode_block(const unsigned char *blk, int count) {
+    int key[REPORT_NUM_FIELDS], n = 0, i;
+    unsigned long epoch = 0;
+    
+    for (i = 0; i < 4; i++) epoch |= (unsigned long)blk[LOG_OFS_EPOCH + i] << (8 * i);
+    for (i = 0; i < REPORT_NUM_FIELDS; i++) {
+        key[i] = (short)(blk[LOG_OFS_KEY + 2 * i] | blk[LOG_OFS_KEY + 2 * i + 1] << 8);
+        dec_val[count][i] = key[i];
+    }
+    dec_epoch[count++] = epoch;
+    
+    for (int k = 1; ; k++) {
+        for (i = 0; i < REPORT_NUM_FIELDS && n < LOG_DATA_NIBS; i++) {
+            unsigned char c = nibble(blk, n);
+            
+            if (c == LOG_NIB_END) break;
+            n++;
+            if (c == LOG_NIB_ESC) {
+                unsigned int v = 0;
+                
+                if (n + 4 > LOG_DATA_NIBS) return -1;
+                for (int j = 0; j < 4; j++) v = (v << 4) | nibble(blk, n++);
+                dec_val[count][i] = (short)v;
+            } else {
+                dec_val[count][i] = key[i] + c - LOG_NIB_BIAS;
+            }
+        }
+        if (i == 0) break;
+        if (i < REPORT_NUM_FIELDS) return -1;      // Esantion neterminat
+        dec_epoch[count++] = epoch + (unsigned long)k * LOG_STEP_S;
+    }
+    return count;
+}
+
+// Toate blocurile, de la cel mai vechi (secventa circulara pe 8 biti)
+static int decode_log(int *blocks) {
+    int order[LOG_SLOTS], used = 0, count = 0;
+    
+    for (int s = 0; s < LOG_SLOTS; s++) {
+        if (ee_mem[EE_LOG_BASE + s * LOG_BLK_SIZE + LOG_OFS_FLAGS] != LOG_F_EMPTY) order[used++] = s;
+    }
+    for (int a = 0; a < used; a++) {
+        for (int b = a + 1; b < used; b++) {
+            signed char d = (signed char)(ee_mem[EE_LOG_BASE + order[a] * LOG_BLK_SIZE + LOG_OFS_SEQ] -
+                                          ee_mem[EE_LOG_BASE + order[b] * LOG_BLK_SIZE + LOG_OFS_SEQ]);
+            if (d > 0) {
+                int t = order[a];
+                order[a] = order[b];
+                order[b] = t;
+            }
+        }
+    }
+    for (int a = 0; a < used; a++) {
+        count = decode_block(&ee_mem[EE_LOG_BASE + order[a] * LOG_BLK_SIZE], count);
+        if (count < 0) return -1;
+    }
+    *blocks = used;
+    return count;
+}
+
+// Termina scrierea EEPROM in curs
+static void ee_flush(void) {
+    while (ee_wr_pos != EE_WR_IDLE) EE_Service();
+}
+
+// Valori care oscileaza cu cel mult +/-jitter in jurul unui nivel; spike =
+// sansa (%) ca nivelul unui canal sa sara cu pana la +/-200 (cifre 0xE).
+// cut = esantionul intrerupt de reset (-1 = niciunul).
+static int run(const char *name, int samples, int jitter, int spike, int cut, double min_ratio) {
+    int level[REPORT_NUM_FIELDS] = { 215, 455, 620, 221, 470 }, v[REPORT_NUM_FIELDS];
+    int blocks, count, first, bad = 0;
+    rtc_t start = { 0, 0, 0, 1, 1, 24 };
+    
+    memset(ee_mem, 0xFF, sizeof ee_mem);
+    RTC_Set(&start, 0);
+    time_valid = 1;
+    link_up = 0;
+    log_blk_open = 0;
+    ee_wr_pos = EE_WR_IDLE;
+    Log_Init();
+    srand(1);
+    
+    for (int s = 0; s < samples; s++) {
+        for (int i = 0; i < REPORT_NUM_FIELDS; i++) {
+            if (rand() % 100 < spike) level[i] += rand() % 401 - 200;
+            v[i] = level[i] + rand() % (2 * jitter + 1) - jitter;
+        }
+        temp1 = v[0];
+        humid1 = v[1];
+        light = v[2];
+        temp2 = v[3];
+        humid2 = v[4];
+        memcpy(hist[s], v, sizeof v);
+        hist_epoch[s] = RTC_ToEpoch((const rtc_t *)&rtc);
+        
+        // Task_Second ruleaza in fiecare secunda; doar prima din pas scrie
+        for (int sec = 0; sec < LOG_STEP_S; sec++) {
+            Log_Append();
+            if (s == cut && sec == 0) {
+                EE_Service();               // Reset dupa primul octet
+                ee_wr_pos = EE_WR_IDLE;
+                log_blk_open = 0;
+                Log_Init();
+            }
+            ee_flush();
+            RTC_Tick();
+        }
+    }
+    
+    count = decode_log(&blocks);
+    first = samples - count;
+    if (count <= 0 || first < 0) {
+        printf("%s: jurnal nedecodabil\n", name);
+        return 1;
+    }
+    for (int k = 0; k < count; k++) {
+        int s = first + k;
+        
+        if (memcmp(hist[s], dec_val[k], sizeof dec_val[k]) || hist_epoch[s] != dec_epoch[k]) bad++;
+    }
+    
+    double ratio = count * 10.0 / (blocks * LOG_BLK_SIZE);
+    printf("%s: %d esantioane, %d in %d blocuri, %d gresite, %.2fx fata de 10 B/esantion\n",
+           name, samples, count, blocks, bad, ratio);
+    return bad || ratio < min_ratio;
+}
+
+int main(void) {
+    int fail = 0;
+    
+    fail |= run("lent", LOG_SLOTS * 20, 3, 0, -1, LOG_MIN_RATIO);
+    fail |= run("salturi", 200, 3, 5, -1, 0.0);
+    fail |= run("reset", 200, 3, 2, 190, 0.0);
+    return fail;
+}
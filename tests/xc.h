@@ -0,0 +1,41 @@
+// Inlocuitor pentru <xc.h> la compilarea pe calculator (tests/): registrele
+// si bitii lor sunt variabile obisnuite, iar intrinsecile nu fac nimic.
+#ifndef TESTS_XC_H
+#define TESTS_XC_H
+
+#define __interrupt()
+#define __bit unsigned char
+#define __delay_ms(x) ((void)(x))
+#define __delay_us(x) ((void)(x))
+#define NOP() ((void)0)
+#define SLEEP() ((void)0)
+#define CLRWDT() ((void)0)
+
+#define R(n) volatile unsigned char n;
+R(PORTA) R(PORTB) R(PORTC) R(PORTD) R(TRISA) R(TRISB) R(TRISC) R(TRISD) R(ADCON0) R(ADCON1) R(ADRESH) R(ADRESL)
+R(ANSEL) R(ANSELH) R(SPBRG) R(SPBRGH) R(TXSTA) R(RCSTA) R(BAUDCTL) R(TXREG) R(RCREG) R(T1CON) R(TMR1H) R(TMR1L)
+R(OSCCON) R(OSCTUNE) R(SSPCON) R(SSPCON2) R(SSPSTAT) R(SSPADD) R(SSPBUF) R(EEADR) R(EEDAT) R(EEDATA) R(EECON1) R(EECON2)
+R(IOCB) R(WPUB) R(OPTION_REG) R(WDTCON) R(PIE1) R(PIR1) R(INTCON) R(PIE2) R(PIR2) R(T2CON) R(PR2) R(TMR2)
+R(TRISC0) R(TRISC1) R(TRISC2) R(TRISC3) R(TRISC4) R(TRISC6) R(TRISC7) R(TRISA3) R(TRISA4) R(TRISB0) R(TRISB1) R(TRISB2) R(TRISB3)
+R(RC0) R(RC1) R(RC2) R(RA3) R(RA4) R(RA0) R(RA1) R(RA2) R(TXIF) R(RCIF) R(RB0) R(RB1) R(RB2) R(RB3) R(TRMT) R(RD4) R(RD5) R(RD6) R(RD7)
+R(TRISD4) R(TRISD5) R(TRISD6) R(TRISD7)
+#undef R
+
+struct xc_bits {
+    unsigned GO:1, GO_nDONE:1, ADON:1, CHS:4, HTS:1, LTS:1, IRCF:3, SCS:1, OSTS:1,
+        RCIE:1, TXIE:1, TMR1IE:1, ADIE:1, SSPIE:1, RCIF:1, TXIF:1, TMR1IF:1, ADIF:1, SSPIF:1, BCLIF:1,
+        PEIE:1, GIE:1, RBIE:1, RBIF:1, INTE:1, INTF:1, T0IE:1, T0IF:1,
+        RB0:1, RB1:1, RB2:1, RB3:1, RB4:1, RA4:1, RA3:1, RC3:1, RC4:1, RC0:1, RC1:1, RC2:1, RC6:1, RC7:1,
+        TRISC3:1, TRISC4:1, TRISC2:1, TRISD4:1, TRISD5:1, TRISD6:1, TRISD7:1, RD4:1, RD5:1, RD6:1, RD7:1,
+        OERR:1, FERR:1, CREN:1, SPEN:1, RX9D:1, TRMT:1, TXEN:1, BRGH:1, SYNC:1,
+        BRG16:1, WUE:1, ABDEN:1, RCIDL:1, ABDOVF:1,
+        SEN:1, RSEN:1, PEN:1, RCEN:1, ACKEN:1, ACKDT:1, ACKSTAT:1, SSPEN:1, SSPM:4, WCOL:1, SSPOV:1, BF:1, R_nW:1, SMP:1, CKE:1,
+        RD:1, WR:1, WREN:1, WRERR:1, EEPGD:1, SWDTEN:1, WDTPS:4, nRBPU:1, PSA:1, PS:3,
+        TMR1ON:1, T1OSCEN:1, TMR1CS:1, T1CKPS:2, nT1SYNC:1, TUN:5,
+        nTO:1, nPD:1, IOCB0:1, IOCB1:1, IOCB2:1, IOCB3:1, WPUB0:1, WPUB1:1, WPUB2:1, WPUB3:1;
+};
+volatile struct xc_bits ADCON0bits, OSCCONbits, PIE1bits, PIR1bits, INTCONbits, PORTBbits, PORTAbits, PORTCbits,
+    PORTDbits, TRISCbits, TRISDbits, RCSTAbits, TXSTAbits, BAUDCTLbits, SSPCON2bits, SSPCONbits, SSPSTATbits,
+    EECON1bits, WDTCONbits, OPTION_REGbits, T1CONbits, OSCTUNEbits, IOCBbits, WPUBbits, PIE2bits, PIR2bits, STATUSbits;
+
+#endif